@@ -1,27 +1,433 @@
 #include <slimsig/slimsig.h>
+#include <slimsig/static_signal.h>
+#include <slimsig/keyed_signal.h>
+#include <slimsig/mailbox_signal.h>
+#include <slimsig/compact_signal.h>
+#include <slimsig/queued_signal.h>
+#include <slimsig/slab_allocator.h>
+#include <slimsig/connection_set.h>
 #include <memory>
 #include <vector>
-#include <iostream>
-#include <chrono>
+#include <tuple>
+#include <functional>
+#include <thread>
+#include "harness.h"
+
+using signal_type = slimsig::signal<void(int)>;
+using connection_type = signal_type::connection;
+
 long long count = 0;
 void foo(int i) {
-  count += 1;
+  count += i;
 }
-int main(int argc, char* argv[]) {
-  std::cout << "Slimmer Signals benchmark...\n";
-  slimsig::signal<void(int)> signal;
-  auto start = std::chrono::high_resolution_clock::now();
-  for (unsigned i = 0; i < 100000; i++) {
+struct receiver {
+  long long total = 0;
+  void on_event(int i) { total += i; }
+};
+
+static void emit_cases()
+{
+  for (std::size_t slots : { 0, 1, 2, 8, 64, 10000 }) {
+    auto signal = std::make_shared<signal_type>();
+    for (std::size_t i = 0; i < slots; i++) signal->connect(&foo);
+    bench::add("emit/function_pointer/" + std::to_string(slots) + " slots", 1, [signal] (std::uint64_t n) {
+      for (std::uint64_t i = 0; i < n; i++) signal->emit(1);
+    });
+  }
+  {
+    auto signal = std::make_shared<signal_type>();
+    auto total = std::make_shared<long long>(0);
+    for (int i = 0; i < 64; i++) signal->connect([total] (int n) { *total += n; });
+    bench::add("emit/lambda/64 slots", 1, [signal] (std::uint64_t n) {
+      for (std::uint64_t i = 0; i < n; i++) signal->emit(1);
+    });
+  }
+  {
+    auto signal = std::make_shared<signal_type>();
+    auto target = std::make_shared<receiver>();
+    for (int i = 0; i < 64; i++) signal->connect(std::bind(&receiver::on_event, target.get(), std::placeholders::_1));
+    bench::add("emit/bound_member/64 slots", 1, [signal, target] (std::uint64_t n) {
+      for (std::uint64_t i = 0; i < n; i++) signal->emit(1);
+    });
+  }
+  {
+    auto signal = std::make_shared<signal_type>();
+    auto target = std::make_shared<receiver>();
+    for (int i = 0; i < 64; i++) signal->connect(target.get(), &receiver::on_event);
+    bench::add("emit/member_pair/64 slots", 1, [signal, target] (std::uint64_t n) {
+      for (std::uint64_t i = 0; i < n; i++) signal->emit(1);
+    });
+  }
+  {
+    auto signal = std::make_shared<signal_type>();
+    for (int i = 0; i < 4; i++) signal->connect([] (int n) { count += n; });
+    bench::add("emit/lambda/4 slots", 1, [signal] (std::uint64_t n) {
+      for (std::uint64_t i = 0; i < n; i++) signal->emit(1);
+    });
+    auto slot = [] (int n) { count += n; };
+    auto fixed = slimsig::make_static_signal<void(int)>(slot, slot, slot, slot);
+    // everything inlines here, so keep the compiler from folding the loop into one addition
+    bench::add("emit/static_signal/4 slots", 1, [fixed] (std::uint64_t n) mutable {
+      for (std::uint64_t i = 0; i < n; i++) {
+        fixed.emit(1);
+        bench::do_not_optimize(count);
+      }
+    });
+  }
+}
+
+static void reentrancy_cases()
+{
+  {
+    // the first slot disconnects the second and connects a replacement, so every emit compacts
+    auto signal = std::make_shared<signal_type>();
+    auto victim = std::make_shared<connection_type>();
+    signal->connect([signal, victim] (int) {
+      victim->disconnect();
+      *victim = signal->connect(&foo);
+    });
+    *victim = signal->connect(&foo);
+    for (int i = 0; i < 62; i++) signal->connect(&foo);
+    bench::add("emit/disconnect during emit/64 slots", 1, [signal] (std::uint64_t n) {
+      for (std::uint64_t i = 0; i < n; i++) signal->emit(1);
+    });
+  }
+  {
+    // every emit recurses four levels deep
+    auto signal = std::make_shared<signal_type>();
+    signal->connect([signal] (int depth) {
+      if (depth < 4) signal->emit(depth + 1);
+    });
+    for (int i = 0; i < 7; i++) signal->connect(&foo);
+    bench::add("emit/nested re-entrant/depth 4", 1, [signal] (std::uint64_t n) {
+      for (std::uint64_t i = 0; i < n; i++) signal->emit(1);
+    });
+  }
+  {
+    // each signal relays to the next, five signals with two slots each
+    std::vector<std::shared_ptr<signal_type>> chain;
+    for (int i = 0; i < 5; i++) {
+      chain.push_back(std::make_shared<signal_type>());
+      chain.back()->connect(&foo);
+      chain.back()->connect(&foo);
+      if (i > 0) chain[i - 1]->connect(chain.back());
+    }
+    bench::add("emit/relay chain/depth 4", 1, [chain] (std::uint64_t n) {
+      for (std::uint64_t i = 0; i < n; i++) chain.front()->emit(1);
+    });
+  }
+  {
+    auto signal = std::make_shared<signal_type>();
+    for (int i = 0; i < 8; i++) signal->connect(&foo);
+    bench::add("connect_once churn/8 slots", 1, [signal] (std::uint64_t n) {
+      for (std::uint64_t i = 0; i < n; i++) {
+        signal->connect_once(&foo);
+        signal->emit(1);
+      }
+    });
+  }
+  {
+    auto signal = std::make_shared<signal_type>();
+    bench::add("disconnect_all mid-emit/8 slots", 1, [signal] (std::uint64_t n) {
+      for (std::uint64_t i = 0; i < n; i++) {
+        signal->connect([signal] (int) { signal->disconnect_all(); });
+        for (int s = 0; s < 7; s++) signal->connect(&foo);
+        signal->emit(1);
+      }
+    });
+  }
+}
+
+static void connection_cases()
+{
+  {
+    auto signal = std::make_shared<signal_type>();
+    bench::add("connect + disconnect", 1, [signal] (std::uint64_t n) {
+      for (std::uint64_t i = 0; i < n; i++) signal->connect(&foo).disconnect();
+    });
+  }
+  {
+    auto signal = std::make_shared<signal_type>();
+    auto connections = std::make_shared<std::vector<connection_type>>();
+    for (int i = 0; i < 1000; i++) connections->push_back(signal->connect(&foo));
+    bench::add("connection::connected()/1000 connections", 1000, [signal, connections] (std::uint64_t n) {
+      std::size_t live = 0;
+      for (std::uint64_t i = 0; i < n; i++) {
+        for (auto& connection : *connections) live += connection.connected();
+      }
+      bench::do_not_optimize(live);
+    });
+  }
+}
+
+template <class Policy>
+struct trickle_traits : slimsig::signal_traits<void(int)> {
+  using compaction_policy = Policy;
+};
+
+// a big signal where one slot is replaced before every emit, the case compaction policies are for
+template <class Policy>
+static void trickle_case(const std::string& name)
+{
+  using trickle_signal = slimsig::signal<void(int), trickle_traits<Policy>>;
+  auto signal = std::make_shared<trickle_signal>();
+  auto connections = std::make_shared<std::vector<typename trickle_signal::connection>>();
+  for (int i = 0; i < 50000; i++) connections->push_back(signal->connect(&foo));
+  auto next = std::make_shared<std::size_t>(0);
+  bench::add("emit/one disconnect per emit/50000 slots/" + name, 1, [signal, connections, next] (std::uint64_t n) {
+    for (std::uint64_t i = 0; i < n; i++) {
+      auto& connection = (*connections)[(*next)++ % connections->size()];
+      connection.disconnect();
+      connection = signal->connect(&foo);
+      signal->emit(1);
+    }
+  });
+}
+
+// slots that have been disconnected but not compacted away yet, emit has to skip them
+template <slimsig::slot_layout Layout>
+struct tombstone_traits : slimsig::signal_traits<void(int)> {
+  using compaction_policy = slimsig::compact_ratio<100>;
+  static constexpr slimsig::slot_layout layout = Layout;
+};
+
+template <slimsig::slot_layout Layout>
+static void tombstone_case(const std::string& name, unsigned percent_dead)
+{
+  using tombstone_signal = slimsig::signal<void(int), tombstone_traits<Layout>>;
+  auto signal = std::make_shared<tombstone_signal>();
+  std::vector<typename tombstone_signal::connection> connections;
+  for (int i = 0; i < 10000; i++) connections.push_back(signal->connect(&foo));
+  // spread the dead slots out the way random disconnects would
+  std::uint32_t state = 12345;
+  for (auto& connection : connections) {
+    state = state * 1103515245 + 12345;
+    if ((state >> 16) % 100 < percent_dead) connection.disconnect();
+  }
+  bench::add("emit/" + std::to_string(percent_dead) + "% tombstones/10000 slots/" + name, 1, [signal] (std::uint64_t n) {
+    for (std::uint64_t i = 0; i < n; i++) signal->emit(1);
+  });
+}
+
+static void compaction_cases()
+{
+  trickle_case<slimsig::compact_always>("compact_always");
+  trickle_case<slimsig::compact_ratio<25>>("compact_ratio<25>");
+  trickle_case<slimsig::compact_incremental<1024>>("compact_incremental<1024>");
+  for (unsigned percent : { 30u, 60u, 90u }) {
+    tombstone_case<slimsig::slot_layout::interleaved>("interleaved", percent);
+    tombstone_case<slimsig::slot_layout::split>("split", percent);
+  }
+}
+
+// lots of short lived objects that each own a signal with a couple of slots
+template <class Signal>
+static void construct_case(const std::string& name)
+{
+  bench::add("construct + connect 2 + emit/" + name, 1, [] (std::uint64_t n) {
+    for (std::uint64_t i = 0; i < n; i++) {
+      Signal signal;
       signal.connect(&foo);
+      signal.connect(&foo);
+      signal.emit(1);
+    }
+  });
+  // most signals embedded in an object are never connected to
+  bench::add("construct + emit unconnected/" + name, 1, [] (std::uint64_t n) {
+    for (std::uint64_t i = 0; i < n; i++) {
+      Signal signal;
+      signal.emit(1);
+    }
+  });
+  bench::add_size(name, sizeof(Signal));
+}
+
+struct concurrent_traits : slimsig::signal_traits<void(int)> {
+  using thread_policy = slimsig::concurrent;
+};
+
+static void construction_cases()
+{
+  construct_case<signal_type>("signal");
+  construct_case<slimsig::small_signal<void(int), 2>>("small_signal<2>");
+  construct_case<slimsig::compact_signal<void(int)>>("compact_signal");
+  bench::add_size("signal, concurrent thread_policy", sizeof(slimsig::signal<void(int), concurrent_traits>));
+  bench::add_size("queued_signal", sizeof(slimsig::queued_signal<void(int)>));
+  bench::add_size("mailbox_signal", sizeof(slimsig::mailbox_signal<void(int)>));
+  bench::add_size("keyed_signal<int>", sizeof(slimsig::keyed_signal<int, void(int)>));
+}
+
+static void batch_cases()
+{
+  auto events = std::make_shared<std::vector<std::tuple<int>>>(256, std::make_tuple(1));
+  for (auto order : { slimsig::batch_order::event_major, slimsig::batch_order::slot_major }) {
+    auto signal = std::make_shared<signal_type>();
+    for (int i = 0; i < 64; i++) signal->connect(&foo);
+    auto name = order == slimsig::batch_order::event_major ? "event_major" : "slot_major";
+    bench::add(std::string("emit_batch/") + name + "/64 slots", events->size(), [signal, events, order] (std::uint64_t n) {
+      for (std::uint64_t i = 0; i < n; i++) signal->emit_batch(events->begin(), events->end(), order);
+    });
+  }
+}
+
+// an event bus with 1000 topics and 4 subscribers each, every emit has one topic's worth of work
+static void keyed_cases()
+{
+  {
+    auto signal = std::make_shared<slimsig::signal<void(int, int)>>();
+    for (int topic = 0; topic < 1000; topic++) {
+      for (int i = 0; i < 4; i++) signal->connect([topic] (int t, int n) { if (t == topic) count += n; });
+    }
+    auto next = std::make_shared<int>(0);
+    bench::add("emit/filter in every slot/1000 topics x 4 slots", 1, [signal, next] (std::uint64_t n) {
+      for (std::uint64_t i = 0; i < n; i++) signal->emit((*next)++ % 1000, 1);
+    });
+  }
+  {
+    auto signal = std::make_shared<slimsig::keyed_signal<int, void(int)>>();
+    for (int topic = 0; topic < 1000; topic++) {
+      for (int i = 0; i < 4; i++) signal->connect(topic, &foo);
+    }
+    auto next = std::make_shared<int>(0);
+    bench::add("emit/keyed_signal/1000 topics x 4 slots", 1, [signal, next] (std::uint64_t n) {
+      for (std::uint64_t i = 0; i < n; i++) signal->emit((*next)++ % 1000, 1);
+    });
   }
-  auto diff = std::chrono::high_resolution_clock::now() - start;
-  std::cout << "Connecting Time: " << std::chrono::duration_cast<std::chrono::milliseconds>(diff).count() << "ms\n";
-  std::cout << "Slot Count: " << signal.slot_count() << "\n";
-  start = std::chrono::high_resolution_clock::now();
-  for (unsigned i = 0; i < 10000; i++){
-    signal.emit(1);
+}
+
+// events handed from a producer thread to the signal's home thread, which pumps until it has them all
+static void mailbox_cases()
+{
+  auto signal = std::make_shared<slimsig::mailbox_signal<void(int)>>(1024);
+  for (int i = 0; i < 4; i++) signal->connect(&foo);
+  bench::add("mailbox_signal/cross-thread emit + pump/4 slots", 1, [signal] (std::uint64_t n) {
+    std::thread producer([signal, n] {
+      for (std::uint64_t i = 0; i < n; i++) signal->emit(1);
+    });
+    for (std::uint64_t pumped = 0; pumped < n;) {
+      pumped += signal->pump();
+      if (pumped < n) std::this_thread::yield();
+    }
+    producer.join();
+  });
+  bench::add("mailbox_signal/post + pump on the home thread/4 slots", 1, [signal] (std::uint64_t n) {
+    for (std::uint64_t i = 0; i < n; i++) {
+      signal->post(1);
+      if (i % 64 == 63) signal->pump();
+    }
+    signal->pump();
+  });
+}
+
+// a frame's worth of sibling signals with a couple of slots each, emitted one after the other
+template <class Signal, class Make>
+static void sibling_case(const std::string& name, Make make)
+{
+  struct siblings {
+    slimsig::slab_pool pool;
+    std::vector<std::unique_ptr<int[]>> junk;
+    std::vector<Signal> signals;
+  };
+  auto state = std::make_shared<siblings>();
+  for (int i = 0; i < 1000; i++) {
+    state->signals.push_back(make(state->pool));
+    state->signals.back().connect(&foo);
+    // other allocations land in between, like they do in a real program
+    state->junk.emplace_back(new int[12]);
+    state->signals.back().connect(&foo);
   }
-  diff = std::chrono::high_resolution_clock::now() - start;
-  std::cout << "Emit Time: " << std::chrono::duration_cast<std::chrono::milliseconds>(diff).count() << "ms\n";
-  std::cout << "Emit Count: " << count << "\n";
+  bench::add("emit/1000 sibling signals x 2 slots/" + name, 1000, [state] (std::uint64_t n) {
+    for (std::uint64_t i = 0; i < n; i++) {
+      for (auto& signal : state->signals) signal.emit(1);
+    }
+  });
+}
+
+static void slab_cases()
+{
+  sibling_case<signal_type>("heap", [] (slimsig::slab_pool&) { return signal_type(); });
+  using slab_signal = slimsig::slab_signal<void(int)>;
+  sibling_case<slab_signal>("slab_pool", [] (slimsig::slab_pool& pool) { return slab_signal(&pool); });
+}
+
+template <class ShrinkPolicy>
+struct shrink_traits : slimsig::signal_traits<void(int)> {
+  using shrink_policy = ShrinkPolicy;
+};
+
+// bursty subscribers: lots of slots come and go, a few stay
+template <class ShrinkPolicy>
+static void shrink_case(const std::string& name)
+{
+  using signal = slimsig::signal<void(int), shrink_traits<ShrinkPolicy>>;
+  bench::add("1000 connects + disconnect_all/" + name, 1000, [] (std::uint64_t n) {
+    signal burst;
+    for (std::uint64_t i = 0; i < n; i++) {
+      for (int slot = 0; slot < 1000; slot++) burst.connect(&foo);
+      burst.disconnect_all();
+    }
+  });
+  signal idle;
+  for (int slot = 0; slot < 100000; slot++) idle.connect(&foo);
+  idle.disconnect_all();
+  for (int slot = 0; slot < 4; slot++) idle.connect(&foo);
+  bench::add_size("memory_usage() after 100k slots/" + name, idle.memory_usage());
+}
+
+static void shrink_cases()
+{
+  shrink_case<slimsig::shrink_never>("shrink_never");
+  shrink_case<slimsig::shrink_below<4>>("shrink_below<4>");
+}
+
+// a view subscribing 20 slots to each of 25 signals and tearing them all down again
+template <class Signal>
+static void teardown_case(const std::string& name)
+{
+  auto signals = std::make_shared<std::vector<Signal>>(25);
+  bench::add("connect + teardown 25 signals x 20/scoped_connection/" + name, 500, [signals] (std::uint64_t n) {
+    using scoped = slimsig::scoped_connection<typename Signal::connection>;
+    std::vector<scoped> connections;
+    for (std::uint64_t i = 0; i < n; i++) {
+      // scoped_connection can't be moved safely, so it must never reallocate
+      connections.reserve(500);
+      for (int slot = 0; slot < 20; slot++) {
+        for (auto& signal : *signals) connections.emplace_back(signal.connect(&foo));
+      }
+      connections.clear();
+    }
+  });
+  bench::add("connect + teardown 25 signals x 20/connection_set/" + name, 500, [signals] (std::uint64_t n) {
+    slimsig::connection_set connections;
+    for (std::uint64_t i = 0; i < n; i++) {
+      connections.reserve(500);
+      for (int slot = 0; slot < 20; slot++) {
+        for (auto& signal : *signals) connections += signal.connect(&foo);
+      }
+      connections.disconnect_all();
+    }
+  });
+}
+
+static void teardown_cases()
+{
+  teardown_case<signal_type>("signal");
+  teardown_case<slimsig::signal<void(int), concurrent_traits>>("concurrent");
+}
+
+int main(int argc, char* argv[]) {
+  emit_cases();
+  reentrancy_cases();
+  connection_cases();
+  construction_cases();
+  compaction_cases();
+  batch_cases();
+  keyed_cases();
+  mailbox_cases();
+  slab_cases();
+  shrink_cases();
+  teardown_cases();
+  auto status = bench::run(argc, argv);
+  bench::do_not_optimize(count);
+  return status;
 }
@@ -0,0 +1,214 @@
+//
+//  harness.h
+//  slimsig
+//
+//  Tiny benchmark harness: calibrated repetitions, median ns/op, allocations/op and JSON output
+//
+
+#ifndef slimsig_benchmark_harness_h
+#define slimsig_benchmark_harness_h
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <new>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace bench {
+
+// global operator new is replaced below so every benchmark can report allocations per op
+inline std::atomic<std::uint64_t>& allocation_count() {
+  static std::atomic<std::uint64_t> count { 0 };
+  return count;
+}
+
+// keeps the optimizer from throwing away a value we computed
+template <class T>
+inline void do_not_optimize(const T& value) {
+#if defined(__GNUC__) || defined(__clang__)
+  asm volatile("" : : "r,m"(value) : "memory");
+#else
+  static volatile const T* sink;
+  sink = &value;
+#endif
+}
+
+// run(iterations) runs the body that many times, each run of the body counts as ops_per_iteration operations
+struct benchmark_case {
+  std::string name;
+  std::uint64_t ops_per_iteration;
+  std::function<void(std::uint64_t)> run;
+};
+
+struct result {
+  std::string name;
+  std::uint64_t iterations;
+  double median_ns;
+  double min_ns;
+  double mad_ns;
+  double allocations;
+};
+
+struct options {
+  std::string filter;
+  unsigned samples = 15;
+  double sample_ms = 10;
+  bool json = false;
+};
+
+inline std::vector<benchmark_case>& registry() {
+  static std::vector<benchmark_case> cases;
+  return cases;
+}
+
+inline void add(std::string name, std::uint64_t ops, std::function<void(std::uint64_t)> run) {
+  registry().push_back({ std::move(name), ops, std::move(run) });
+}
+
+// sizeof of the types being compared, reported next to the timings
+inline std::vector<std::pair<std::string, std::size_t>>& sizes() {
+  static std::vector<std::pair<std::string, std::size_t>> types;
+  return types;
+}
+
+inline void add_size(std::string name, std::size_t bytes) {
+  sizes().emplace_back(std::move(name), bytes);
+}
+
+inline double median(std::vector<double> values) {
+  std::sort(values.begin(), values.end());
+  auto mid = values.size() / 2;
+  return values.size() % 2 ? values[mid] : (values[mid - 1] + values[mid]) / 2;
+}
+
+inline result measure(const benchmark_case& c, const options& opts) {
+  using clock = std::chrono::steady_clock;
+  auto time = [&] (std::uint64_t iterations) {
+    auto start = clock::now();
+    c.run(iterations);
+    return std::chrono::duration<double, std::nano>(clock::now() - start).count();
+  };
+  // grow the iteration count until a sample takes long enough to swamp clock overhead
+  std::uint64_t iterations = 1;
+  for (;;) {
+    auto elapsed = time(iterations);
+    if (elapsed >= opts.sample_ms * 1e6 || iterations >= (std::uint64_t(1) << 30)) break;
+    auto target = elapsed > 0 ? opts.sample_ms * 1e6 / elapsed * iterations * 1.2 : iterations * 10.0;
+    iterations = std::max<std::uint64_t>(iterations * 2, std::min<std::uint64_t>(std::uint64_t(target), iterations * 100));
+  }
+  std::vector<double> per_op;
+  std::uint64_t allocations = 0;
+  for (unsigned i = 0; i < opts.samples; i++) {
+    auto before = allocation_count().load(std::memory_order_relaxed);
+    auto start = clock::now();
+    c.run(iterations);
+    auto elapsed = std::chrono::duration<double, std::nano>(clock::now() - start).count();
+    allocations += allocation_count().load(std::memory_order_relaxed) - before;
+    per_op.push_back(elapsed / double(iterations * c.ops_per_iteration));
+  }
+  auto mid = median(per_op);
+  std::vector<double> deviations;
+  for (auto v : per_op) deviations.push_back(std::fabs(v - mid));
+  return {
+    c.name, iterations, mid,
+    *std::min_element(per_op.begin(), per_op.end()),
+    median(deviations),
+    double(allocations) / double(opts.samples * iterations * c.ops_per_iteration)
+  };
+}
+
+inline options parse(int argc, char* argv[]) {
+  options opts;
+  for (int i = 1; i < argc; i++) {
+    std::string arg = argv[i];
+    if (arg == "--json") opts.json = true;
+    else if (arg == "--filter" && i + 1 < argc) opts.filter = argv[++i];
+    else if (arg == "--samples" && i + 1 < argc) opts.samples = std::max(1, std::atoi(argv[++i]));
+    else if (arg == "--sample-ms" && i + 1 < argc) opts.sample_ms = std::atof(argv[++i]);
+    else {
+      std::cerr << "usage: " << argv[0] << " [--json] [--filter substring] [--samples n] [--sample-ms ms]\n";
+      std::exit(arg == "--help" ? 0 : 1);
+    }
+  }
+  return opts;
+}
+
+inline std::string escape(const std::string& s) {
+  std::string out;
+  for (auto c : s) {
+    if (c == '"' || c == '\\') out += '\\';
+    out += c;
+  }
+  return out;
+}
+
+inline int run(int argc, char* argv[]) {
+  auto opts = parse(argc, argv);
+  std::vector<result> results;
+  if (!opts.json) {
+    std::cout << std::left << std::setw(48) << "benchmark" << std::right << std::setw(12) << "ns/op"
+              << std::setw(10) << "+/-" << std::setw(12) << "min" << std::setw(12) << "allocs/op" << "\n";
+  }
+  for (auto& c : registry()) {
+    if (!opts.filter.empty() && c.name.find(opts.filter) == std::string::npos) continue;
+    auto r = measure(c, opts);
+    if (!opts.json) {
+      std::cout << std::left << std::setw(48) << r.name << std::right << std::fixed << std::setprecision(2)
+                << std::setw(12) << r.median_ns << std::setw(10) << r.mad_ns << std::setw(12) << r.min_ns
+                << std::setw(12) << std::setprecision(3) << r.allocations << std::endl;
+    }
+    results.push_back(r);
+  }
+  if (opts.json) {
+    std::cout << "{\"samples\": " << opts.samples << ", \"benchmarks\": [\n";
+    for (std::size_t i = 0; i < results.size(); i++) {
+      auto& r = results[i];
+      std::cout << "  {\"name\": \"" << escape(r.name) << "\", \"iterations\": " << r.iterations
+                << ", \"ns_per_op\": " << r.median_ns << ", \"mad_ns\": " << r.mad_ns
+                << ", \"min_ns\": " << r.min_ns << ", \"allocations_per_op\": " << r.allocations << "}"
+                << (i + 1 < results.size() ? ",\n" : "\n");
+    }
+    std::cout << "], \"sizes\": [\n";
+    for (std::size_t i = 0; i < sizes().size(); i++) {
+      std::cout << "  {\"type\": \"" << escape(sizes()[i].first) << "\", \"bytes\": " << sizes()[i].second << "}"
+                << (i + 1 < sizes().size() ? ",\n" : "\n");
+    }
+    std::cout << "]}\n";
+  } else if (!sizes().empty()) {
+    std::cout << "\n" << std::left << std::setw(48) << "type" << std::right << std::setw(12) << "sizeof" << "\n";
+    for (auto& size : sizes()) {
+      std::cout << std::left << std::setw(48) << size.first << std::right << std::setw(12) << size.second << "\n";
+    }
+  }
+  return 0;
+}
+
+}
+
+// counting allocator hooks, define BENCH_NO_ALLOCATION_HOOKS if another translation unit already replaces them
+#ifndef BENCH_NO_ALLOCATION_HOOKS
+namespace bench {
+inline void* counted_malloc(std::size_t size) {
+  allocation_count().fetch_add(1, std::memory_order_relaxed);
+  if (auto p = std::malloc(size ? size : 1)) return p;
+  throw std::bad_alloc();
+}
+}
+void* operator new(std::size_t size) { return bench::counted_malloc(size); }
+void* operator new[](std::size_t size) { return bench::counted_malloc(size); }
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete[](void* p) noexcept { std::free(p); }
+void operator delete(void* p, std::size_t) noexcept { std::free(p); }
+void operator delete[](void* p, std::size_t) noexcept { std::free(p); }
+#endif
+
+#endif
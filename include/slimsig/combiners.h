@@ -0,0 +1,110 @@
+//
+//  combiners.h
+//  slimsig
+//
+//  Combiners turn the results of every slot called by an emit into a single value
+//  They follow the same interface as Boost::Signals2 combiners:
+//
+//    struct my_combiner {
+//      using result_type = ...;
+//      template <class InputIterator>
+//      result_type operator()(InputIterator first, InputIterator last);
+//    };
+//
+//  Slots are only called when the iterator is dereferenced, so a combiner that stops
+//  iterating early prevents the remaining slots from running
+//
+
+#ifndef slimsig_combiners_h
+#define slimsig_combiners_h
+
+#include <utility>
+#include <type_traits>
+#include "detail/slot.h"
+
+namespace slimsig {
+
+// returns the result of the last slot, or a default constructed value if there are no slots
+template <class T>
+struct last_value {
+  using result_type = T;
+  template <class InputIterator>
+  result_type operator()(InputIterator first, InputIterator last) const {
+    if (first == last) return detail::default_value<T>();
+    InputIterator current = first;
+    while (++first != last) {
+      *current;
+      current = first;
+    }
+    return *current;
+  }
+};
+
+// calls every slot, this is what void signals use by default
+template <>
+struct last_value<void> {
+  using result_type = void;
+  template <class InputIterator>
+  void operator()(InputIterator first, InputIterator last) const {
+    for (; first != last; ++first) *first;
+  }
+};
+
+// returns the first result that converts to true and stops calling slots
+template <class T>
+struct first_non_null {
+  using result_type = T;
+  template <class InputIterator>
+  result_type operator()(InputIterator first, InputIterator last) const {
+    for (; first != last; ++first) {
+      if (*first) return *first;
+    }
+    return detail::default_value<T>();
+  }
+};
+
+template <class T>
+struct minimum {
+  using result_type = T;
+  template <class InputIterator>
+  result_type operator()(InputIterator first, InputIterator last) const {
+    if (first == last) return detail::default_value<T>();
+    T value = *first;
+    while (++first != last) {
+      if (*first < value) value = *first;
+    }
+    return value;
+  }
+};
+
+template <class T>
+struct maximum {
+  using result_type = T;
+  template <class InputIterator>
+  result_type operator()(InputIterator first, InputIterator last) const {
+    if (first == last) return detail::default_value<T>();
+    T value = *first;
+    while (++first != last) {
+      if (value < *first) value = *first;
+    }
+    return value;
+  }
+};
+
+template <class T>
+struct sum {
+  using result_type = T;
+  sum() : initial() {};
+  sum(T init) : initial(std::move(init)) {};
+  template <class InputIterator>
+  result_type operator()(InputIterator first, InputIterator last) const {
+    T value = initial;
+    for (; first != last; ++first) value = value + *first;
+    return value;
+  }
+  T initial;
+};
+
+}
+
+#endif
@@ -0,0 +1,208 @@
+//
+//  compact_signal.h
+//  slimsig
+//
+//  A signal the size of a pointer that only allocates its slot list once something connects
+//
+
+#ifndef slimsig_compact_signal_h
+#define slimsig_compact_signal_h
+
+#include <iterator>
+#include <memory>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include "slimsig.h"
+
+namespace slimsig {
+
+template <
+  class Handler,
+  class SignalTraits = signal_traits<Handler>,
+  class Allocator = std::allocator<std::function<Handler>>
+> class compact_signal;
+
+/**
+ *  Pointer sized signal for objects that embed lots of signals nobody listens to
+ *
+ *  A signal carries its slot list and bookkeeping inline, which adds up when every object has
+ *  half a dozen of them. compact_signal holds a single pointer to a signal allocated with its
+ *  allocator the first time a slot connects; until then emits return what the combiner makes of no
+ *  slots at all. Once the signal exists everything is forwarded to it, so connecting, disconnecting
+ *  and emitting from inside slots behave exactly like signal, and the signal never moves again:
+ *  moving or swapping a compact_signal trades pointers, even while it emits.
+ *
+ *  disconnect_all() frees the signal again when it isn't emitting. Stats and the name set with
+ *  set_name() belong to the signal, so they start over then. Stateless allocators cost nothing,
+ *  a stateful one is stored next to the pointer. Not thread safe.
+ */
+template <class SignalTraits, class Allocator, class R, class... Args>
+class compact_signal<R(Args...), SignalTraits, Allocator> {
+public:
+  using signal_type = signal<R(Args...), SignalTraits, Allocator>;
+  using allocator_type = Allocator;
+  using result_type = typename signal_type::result_type;
+  using combiner_type = typename signal_type::combiner_type;
+  using connection = typename signal_type::connection;
+  using size_type = std::size_t;
+  static_assert(std::is_same<typename SignalTraits::thread_policy, single_threaded>::value,
+                "compact_signal creates its signal lazily without synchronization, use a single threaded thread_policy");
+
+  explicit compact_signal(const allocator_type& alloc = allocator_type()) : m_storage(body_allocator(alloc)) {};
+  compact_signal(compact_signal&& other) : m_storage(other.m_storage) {
+    m_storage.body = other.m_storage.body;
+    other.m_storage.body = nullptr;
+  }
+  compact_signal& operator=(compact_signal&& other) {
+    swap(other);
+    return *this;
+  }
+  compact_signal(const compact_signal&) = delete;
+  compact_signal& operator=(const compact_signal&) = delete;
+  ~compact_signal() {
+    release();
+  }
+
+  result_type emit(Args... args) {
+    if (m_storage.body) return m_storage.body->emit(std::forward<Args>(args)...);
+    return combiner_type()(no_slots(), no_slots());
+  }
+  result_type operator()(Args... args) {
+    return emit(std::forward<Args>(args)...);
+  }
+  template <class Combiner>
+  typename std::decay<Combiner>::type::result_type emit_with(Combiner&& combiner, Args... args) {
+    if (m_storage.body) return m_storage.body->emit_with(std::forward<Combiner>(combiner), std::forward<Args>(args)...);
+    return combiner(no_slots(), no_slots());
+  }
+  template <class Iterator>
+  void emit_batch(Iterator first, Iterator last, batch_order order = batch_order::event_major) {
+    if (m_storage.body) m_storage.body->emit_batch(first, last, order);
+  }
+  void emit_parallel(Args... args) {
+    if (m_storage.body) m_storage.body->emit_parallel(std::forward<Args>(args)...);
+  }
+  void emit_parallel_on(work_stealing_pool& pool, Args... args) {
+    if (m_storage.body) m_storage.body->emit_parallel_on(pool, std::forward<Args>(args)...);
+  }
+
+  // every overload signal has: callables, (object, method) pairs and relays to a shared_ptr<signal_type>
+  template <class... T>
+  connection connect(T&&... slot) {
+    return body().connect(std::forward<T>(slot)...);
+  }
+  template <class F>
+  connection connect_once(F&& slot) {
+    return body().connect_once(std::forward<F>(slot));
+  }
+  template <class F>
+  connection connect_extended(F&& slot) {
+    return body().connect_extended(std::forward<F>(slot));
+  }
+  template <class T, class Method>
+  connection connect_weak(const std::shared_ptr<T>& object, Method method) {
+    return body().connect_weak(object, method);
+  }
+
+  void disconnect_all() {
+    if (!m_storage.body) return;
+    if (m_storage.body->is_running()) m_storage.body->disconnect_all();
+    else release();
+  }
+
+  size_type slot_count() const {
+    return m_storage.body ? m_storage.body->slot_count() : 0;
+  }
+  bool empty() const {
+    return slot_count() == 0;
+  }
+  size_type get_depth() const {
+    return m_storage.body ? m_storage.body->get_depth() : 0;
+  }
+  bool is_running() const {
+    return get_depth() > 0;
+  }
+  // false until the first connect and again after disconnect_all
+  bool allocated() const {
+    return m_storage.body != nullptr;
+  }
+  // the pointer plus everything the signal takes up, once there is one
+  size_type memory_usage() const {
+    return sizeof(*this) + (m_storage.body ? m_storage.body->memory_usage() : 0);
+  }
+  signal_stats stats() const {
+    return m_storage.body ? m_storage.body->stats() : signal_stats();
+  }
+  void set_name(std::string name) {
+    body().set_name(std::move(name));
+  }
+  allocator_type get_allocator() const {
+    return allocator_type(allocator());
+  }
+
+  void swap(compact_signal& other) {
+    if (this == &other) return;
+    if (allocator() == other.allocator()) {
+      std::swap(m_storage.body, other.m_storage.body);
+    } else {
+      // each signal has to go back to the allocator it came from, trade slots instead
+      std::swap(body(), other.body());
+    }
+  }
+private:
+  using body_traits = typename std::allocator_traits<Allocator>::template rebind_traits<signal_type>;
+  using body_allocator = typename body_traits::allocator_type;
+  // the allocator is a base so an empty one takes up no room
+  struct storage : body_allocator {
+    signal_type* body;
+    storage(const body_allocator& alloc) : body_allocator(alloc), body(nullptr) {};
+  };
+  // what an emit without a signal hands to the combiner, an empty range
+  struct no_slots {
+    using iterator_category = std::input_iterator_tag;
+    using value_type = R;
+    using difference_type = std::ptrdiff_t;
+    using pointer = void;
+    using reference = R;
+    R operator*() const { return detail::default_value<R>(); }
+    no_slots& operator++() { return *this; }
+    bool operator==(const no_slots&) const { return true; }
+    bool operator!=(const no_slots&) const { return false; }
+  };
+
+  body_allocator& allocator() { return m_storage; }
+  const body_allocator& allocator() const { return m_storage; }
+  signal_type& body() {
+    if (!m_storage.body) {
+      auto& alloc = allocator();
+      auto body = body_traits::allocate(alloc, 1);
+      try {
+        body_traits::construct(alloc, std::addressof(*body), allocator_type(alloc));
+      } catch (...) {
+        body_traits::deallocate(alloc, body, 1);
+        throw;
+      }
+      m_storage.body = std::addressof(*body);
+    }
+    return *m_storage.body;
+  }
+  void release() {
+    if (!m_storage.body) return;
+    auto& alloc = allocator();
+    body_traits::destroy(alloc, m_storage.body);
+    body_traits::deallocate(alloc, m_storage.body, 1);
+    m_storage.body = nullptr;
+  }
+
+  storage m_storage;
+};
+
+template <class Handler, class SignalTraits, class Allocator>
+void swap(compact_signal<Handler, SignalTraits, Allocator>& lhs, compact_signal<Handler, SignalTraits, Allocator>& rhs) {
+  lhs.swap(rhs);
+}
+
+}
+
+#endif
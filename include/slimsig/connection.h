@@ -13,6 +13,7 @@
 #include <algorithm>
 #include <limits>
 #include "detail/slot.h"
+#include "detail/handle_table.h"
 
 namespace slimsig {
 template <class Signal>
@@ -20,67 +21,52 @@ class connection;
 
 template <class ThreadPolicy, class Allocator, class F>
 class signal_base;
+template <class SignalTraits, class Allocator, class F>
+class concurrent_signal_base;
+class connection_set;
  // detail
   
   template <class Signal>
   class connection {
-  using slot = typename Signal::slot;
-  using slot_type = slot;
-  using slot_list_iterator = typename Signal::slot_list::iterator;
-  using slot_storage = typename Signal::slot_list;
-  using slot_id = typename slot::slot_id;
-  using signal_holder = typename Signal::signal_holder;
-  connection(std::weak_ptr<signal_holder> slots, const slot_type& slot) : connection(std::move(slots), slot.m_slot_id)  {};
-  connection(std::weak_ptr<signal_holder> slots, unsigned long long slot_id) : m_slots(std::move(slots)), m_slot_id(slot_id) {};
+  using handle_type = detail::slot_handle;
+  connection(handle_type handle) : m_handle(handle) {};
   public:
-    connection() {}; // empty connection
-    connection(const connection& other) : m_slots(other.m_slots), m_slot_id(other.m_slot_id) {};
-    connection(connection&& other) : m_slots(std::move(other.m_slots)), m_slot_id(other.m_slot_id) {};
+    connection() : m_handle() {}; // empty connection
+    connection(const connection& other) = default;
+    // noexcept so slots holding a connection can still be stored inline
+    connection(connection&& other) noexcept : m_handle(other.m_handle) {
+      other.m_handle = handle_type();
+    };
     
-    connection& operator=(connection&& rhs) {
+    connection& operator=(connection&& rhs) noexcept {
       this->swap(rhs);
       return *this;
     }
-    connection& operator=(const connection& rhs) {
-      m_slot_id = rhs.m_slot_id;
-      m_slots = rhs.m_slots;
-      return *this;
-    }
+    connection& operator=(const connection& rhs) = default;
     
-    void swap(connection& other) {
+    void swap(connection& other) noexcept {
       using std::swap;
-      swap(m_slots, other.m_slots);
-      swap(m_slot_id, other.m_slot_id);
+      swap(m_handle, other.m_handle);
     }
     [[gnu::always_inline]]
     inline explicit operator bool() const { return connected(); };
+    // O(1), never touches the signal
     bool connected() const {
-      const auto slots = m_slots.lock();
-      if (slots && slots->signal != nullptr) {
-        return  slots->signal->connected(m_slot_id);
-        //auto slot = (*slots)->find(m_slot_id);
-        //return slot != (*slots)->cend() ? slot->connected() : false;
-      }
-      return false;
+      return detail::handle_table::instance().alive(m_handle);
     }
 
     void disconnect() {
-      std::shared_ptr<signal_holder> slots = m_slots.lock();
-      if (slots != nullptr && slots->signal != nullptr) {
-        slots->signal->disconnect(m_slot_id);
-        //auto slot = *slots->find(m_slot_id);
-        //if (slot != slots->end()) slot->disconnect();
-      }
+      auto signal = static_cast<Signal*>(detail::handle_table::instance().owner(m_handle));
+      if (signal != nullptr) signal->disconnect(m_handle);
     }
     template <class ThreadPolicy, class Allocator, class F>
     friend class signal_base;
-    template < class T, class IDGenerator, class FlagType, class Allocator>
-    friend class slot_list;
-    
+    template <class SignalTraits, class Allocator, class F>
+    friend class concurrent_signal_base;
+    friend class connection_set;
     
   private:
-    std::weak_ptr<signal_holder> m_slots;
-    slot_id m_slot_id;
+    handle_type m_handle;
   };
   
   template <class connection>
@@ -0,0 +1,150 @@
+//
+//  connection_set.h
+//  slimsig
+//
+//  Owns a bunch of connections to any number of signals and disconnects them together
+//
+
+#ifndef slimsig_connection_set_h
+#define slimsig_connection_set_h
+
+#include <algorithm>
+#include <cstddef>
+#include <functional>
+#include <type_traits>
+#include <vector>
+#include "connection.h"
+#include "detail/handle_table.h"
+
+namespace slimsig {
+
+/**
+ *  Scoped container of connections, possibly to signals of different types
+ *
+ *  Destroying the set or calling disconnect_all() groups the connections to concurrent signals by
+ *  signal and hands each signal its whole group at once, so it takes its lock once and publishes
+ *  one new snapshot instead of copying its slot list for every connection. Connections to single
+ *  threaded signals are disconnected one at a time, their handles already lead straight to the slot.
+ *  Connections that were disconnected some other way, or whose signal is gone, are skipped.
+ *
+ *  Move only, like scoped_connection. Not thread safe itself, though the signals it disconnects
+ *  from may be concurrent.
+ */
+class connection_set {
+public:
+  using size_type = std::size_t;
+
+  connection_set() = default;
+  connection_set(connection_set&& other) noexcept : m_entries(std::move(other.m_entries)) {
+    other.m_entries.clear();
+  }
+  // disconnects what this set held before taking over other's connections
+  connection_set& operator=(connection_set&& other) noexcept {
+    if (this != &other) {
+      disconnect_all();
+      m_entries.swap(other.m_entries);
+    }
+    return *this;
+  }
+  connection_set(const connection_set&) = delete;
+  connection_set& operator=(const connection_set&) = delete;
+  ~connection_set() {
+    disconnect_all();
+  }
+
+  template <class Signal>
+  void add(const connection<Signal>& conn) {
+    if (conn.m_handle.index == detail::slot_handle::invalid_index) return;
+    auto grouped = !std::is_same<typename Signal::signal_traits::thread_policy, single_threaded>::value;
+    m_entries.push_back({ nullptr, &disconnect_group<Signal>, conn.m_handle, grouped });
+  }
+  template <class Signal>
+  connection_set& operator+=(const connection<Signal>& conn) {
+    add(conn);
+    return *this;
+  }
+
+  void disconnect_all() {
+    if (m_entries.empty()) return;
+    // destroying a slot's callable may add to or disconnect this set, so work on our own copy
+    std::vector<entry> entries;
+    entries.swap(m_entries);
+    auto& table = detail::handle_table::instance();
+    // single threaded signals find a slot straight from its handle and have nothing to gain from
+    // grouping, so they go one by one. The rest are looked up afterwards
+    auto grouped = entries.begin();
+    for (auto& e : entries) {
+      if (e.grouped) {
+        *grouped++ = e;
+      } else if (auto owner = table.owner(e.handle)) {
+        e.disconnect(owner, &e, &e + 1);
+      }
+    }
+    entries.erase(grouped, entries.end());
+    auto live = entries.begin();
+    for (auto& e : entries) {
+      e.owner = table.owner(e.handle);
+      if (e.owner) *live++ = e;
+    }
+    entries.erase(live, entries.end());
+    std::sort(entries.begin(), entries.end(), [] (const entry& lhs, const entry& rhs) {
+      return std::less<void*>()(lhs.owner, rhs.owner);
+    });
+    for (auto group = entries.begin(); group != entries.end();) {
+      auto end = std::find_if(group, entries.end(), [&] (const entry& e) { return e.owner != group->owner; });
+      // an earlier group may have destroyed a callable that owned this signal, then its handles are
+      // gone too. Any live handle in the group will do, they all belong to the same signal
+      auto live = std::find_if(group, end, [&] (const entry& e) { return table.owner(e.handle) == e.owner; });
+      if (live != end) live->disconnect(live->owner, &*live, &*live + (end - live));
+      group = end;
+    }
+    // keep the capacity unless something was added meanwhile
+    entries.clear();
+    if (m_entries.empty()) m_entries.swap(entries);
+  }
+  // forgets every connection without disconnecting it, like scoped_connection::release
+  void release() {
+    m_entries.clear();
+  }
+
+  void reserve(size_type count) {
+    m_entries.reserve(count);
+  }
+  // connections added, including ones that have been disconnected since
+  size_type size() const {
+    return m_entries.size();
+  }
+  bool empty() const {
+    return m_entries.empty();
+  }
+  void swap(connection_set& other) noexcept {
+    m_entries.swap(other.m_entries);
+  }
+private:
+  struct entry;
+  using disconnect_fn = void (*)(void* signal, const entry* first, const entry* last);
+  struct entry {
+    void* owner;
+    disconnect_fn disconnect;
+    detail::slot_handle handle;
+    // disconnected together with the other connections to its signal
+    bool grouped;
+    // what the signals' batch disconnect reads out of each entry
+    operator const detail::slot_handle&() const { return handle; }
+  };
+
+  template <class Signal>
+  static void disconnect_group(void* signal, const entry* first, const entry* last) {
+    static_cast<Signal*>(signal)->disconnect(first, last);
+  }
+
+  std::vector<entry> m_entries;
+};
+
+inline void swap(connection_set& lhs, connection_set& rhs) noexcept {
+  lhs.swap(rhs);
+}
+
+}
+
+#endif
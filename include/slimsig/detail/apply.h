@@ -0,0 +1,53 @@
+//
+//  apply.h
+//  slimsig
+//
+//  Helpers for calling slots with arguments stored in a tuple
+//
+
+#ifndef slimsig_apply_h
+#define slimsig_apply_h
+
+#include <cstddef>
+#include <tuple>
+#include <utility>
+
+namespace slimsig {
+namespace detail {
+
+template <std::size_t... I>
+struct index_sequence {};
+
+template <std::size_t N, std::size_t... I>
+struct make_index_sequence_impl : make_index_sequence_impl<N - 1, N - 1, I...> {};
+
+template <std::size_t... I>
+struct make_index_sequence_impl<0, I...> {
+  using type = index_sequence<I...>;
+};
+
+template <std::size_t N>
+using make_index_sequence = typename make_index_sequence_impl<N>::type;
+
+// calls fn with the tuple elements as lvalues, the same way emit passes its arguments to
+// every slot but the last
+template <class F, class Tuple, std::size_t... I>
+[[gnu::always_inline]]
+inline auto apply_lvalues(F&& fn, Tuple& args, index_sequence<I...>)
+  -> decltype(std::forward<F>(fn)(std::get<I>(args)...))
+{
+  return std::forward<F>(fn)(std::get<I>(args)...);
+}
+
+template <class F, class Tuple>
+[[gnu::always_inline]]
+inline auto apply_lvalues(F&& fn, Tuple& args)
+  -> decltype(apply_lvalues(std::forward<F>(fn), args, make_index_sequence<std::tuple_size<Tuple>::value>{}))
+{
+  return apply_lvalues(std::forward<F>(fn), args, make_index_sequence<std::tuple_size<Tuple>::value>{});
+}
+
+}
+}
+
+#endif
@@ -0,0 +1,139 @@
+//
+//  bump_arena.h
+//  slimsig
+//
+//  Chunked bump allocator for short lived objects that all die at once
+//
+
+#ifndef slimsig_bump_arena_h
+#define slimsig_bump_arena_h
+
+#include <memory>
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+#include <algorithm>
+#include <cassert>
+#include "slot_storage.h"
+
+namespace slimsig {
+namespace detail {
+
+/**
+ *  Hands out memory by bumping an offset into the current chunk, growing geometrically when a
+ *  chunk runs out. Nothing is freed individually: reset() rewinds the arena and merges its chunks,
+ *  so a workload that repeats at roughly the same size stops allocating after the first round.
+ *  Objects placed in the arena must be destroyed by their owner before reset().
+ *
+ *  Chunks, and the list keeping track of them, come from Allocator. Like a standard container the
+ *  arena only trades allocators on swap when they propagate on swap, otherwise swapping arenas
+ *  requires equal allocators; check can_swap() first.
+ */
+template <class Allocator = std::allocator<unsigned char>>
+class basic_bump_arena {
+  using allocator_traits = typename std::allocator_traits<Allocator>::template rebind_traits<unsigned char>;
+public:
+  using allocator_type = typename allocator_traits::allocator_type;
+
+  explicit basic_bump_arena(std::size_t first_chunk = 1024, const allocator_type& alloc = allocator_type())
+  : m_chunks(chunk_allocator(alloc)), m_used(0), m_first_chunk(first_chunk), m_allocator(alloc) {};
+  explicit basic_bump_arena(const allocator_type& alloc) : basic_bump_arena(1024, alloc) {};
+  basic_bump_arena(basic_bump_arena&& other) : basic_bump_arena(other.m_first_chunk, other.m_allocator) {
+    swap(other);
+  }
+  basic_bump_arena& operator=(basic_bump_arena&& other) {
+    swap(other);
+    return *this;
+  }
+  basic_bump_arena(const basic_bump_arena&) = delete;
+  basic_bump_arena& operator=(const basic_bump_arena&) = delete;
+  ~basic_bump_arena() {
+    release();
+  }
+
+  void* allocate(std::size_t size, std::size_t alignment)
+  {
+    assert(alignment <= alignof(std::max_align_t) && "over-aligned types can't be placed in a bump_arena");
+    if (!m_chunks.empty()) {
+      auto offset = align_up(m_used, alignment);
+      if (offset + size <= m_chunks.back().size) {
+        m_used = offset + size;
+        return m_chunks.back().data + offset;
+      }
+    }
+    auto chunk_size = m_chunks.empty() ? m_first_chunk : m_chunks.back().size * 2;
+    push_chunk(std::max(chunk_size, size));
+    m_used = size;
+    return m_chunks.back().data;
+  }
+
+  // rewinds the arena, if the last round needed several chunks they're merged into one that
+  // fits all of them so the next round doesn't have to grow
+  void reset()
+  {
+    if (m_chunks.size() > 1) {
+      auto size = capacity();
+      release();
+      push_chunk(size);
+    }
+    m_used = 0;
+  }
+
+  // bytes owned by the arena, used or not
+  std::size_t capacity() const
+  {
+    std::size_t total = 0;
+    for (auto& c : m_chunks) total += c.size;
+    return total;
+  }
+
+  // whether swap() can trade chunks with other, each chunk has to go back to the allocator it came from
+  bool can_swap(const basic_bump_arena& other) const
+  {
+    return allocator_traits::propagate_on_container_swap::value || m_allocator == other.m_allocator;
+  }
+  void swap(basic_bump_arena& other)
+  {
+    using std::swap;
+    assert(can_swap(other) && "arenas with unequal allocators that don't propagate on swap can't be swapped");
+    swap(m_chunks, other.m_chunks);
+    swap(m_used, other.m_used);
+    swap(m_first_chunk, other.m_first_chunk);
+    swap_allocators(m_allocator, other.m_allocator);
+  }
+  const allocator_type& get_allocator() const
+  {
+    return m_allocator;
+  }
+private:
+  struct chunk {
+    unsigned char* data;
+    std::size_t size;
+  };
+  using chunk_allocator = typename allocator_traits::template rebind_alloc<chunk>;
+  void push_chunk(std::size_t size)
+  {
+    m_chunks.reserve(m_chunks.size() + 1);
+    m_chunks.push_back(chunk { std::addressof(*allocator_traits::allocate(m_allocator, size)), size });
+  }
+  void release()
+  {
+    for (auto& c : m_chunks) allocator_traits::deallocate(m_allocator, c.data, c.size);
+    m_chunks.clear();
+  }
+  static std::size_t align_up(std::size_t offset, std::size_t alignment)
+  {
+    return (offset + alignment - 1) & ~(alignment - 1);
+  }
+  std::vector<chunk, chunk_allocator> m_chunks;
+  std::size_t m_used;
+  std::size_t m_first_chunk;
+  allocator_type m_allocator;
+};
+
+using bump_arena = basic_bump_arena<>;
+
+}
+}
+
+#endif
@@ -0,0 +1,673 @@
+//
+//  concurrent_signal_base.h
+//  slimsig
+//
+//  signal_base for signal_traits with thread_policy = concurrent
+//
+
+#ifndef slimsig_concurrent_signal_base_h
+#define slimsig_concurrent_signal_base_h
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include <algorithm>
+#include <limits>
+#include <cassert>
+#include <stdexcept>
+
+#include "signal_base.h"
+#include "epoch.h"
+
+namespace slimsig {
+
+template <class SignalTraits, class Allocator, class Handler>
+class concurrent_signal_base;
+
+/**
+ *  Signal that can be emitted from any number of threads while other threads connect and disconnect
+ *
+ *  Emitting never takes a lock: emit registers with the reader epochs and iterates an immutable
+ *  snapshot of the slot list. connect/disconnect/disconnect_all take a writer lock, publish a new
+ *  snapshot and retire the old one, which is freed once no emitting thread can still be reading it.
+ *  Callables are only ever destroyed after the writer lock is released, so their destructors may
+ *  connect to or disconnect from the signal.
+ *
+ *  Semantics match the single threaded signal: slots connected while emitting are not called by
+ *  that emit, slots disconnected while emitting are skipped if they haven't run yet and
+ *  disconnect_all only affects emits that start after it.
+ *  Swapping, moving and destroying a signal must not race with anything else.
+ */
+template<class SignalTraits, class Allocator, class R, class... Args>
+class concurrent_signal_base<SignalTraits, Allocator, R(Args...)>
+{
+  struct slot_node;
+  struct snapshot;
+  struct read_scope;
+public:
+  using signal_traits = SignalTraits;
+  using thread_policy = typename signal_traits::thread_policy;
+  using return_type = typename signal_traits::return_type;
+  using combiner_type = typename signal_traits::combiner_type;
+  using result_type = typename combiner_type::result_type;
+  using allocator_type = Allocator;
+  using slot_id = typename signal_traits::slot_id_type;
+  using callback = detail::inplace_function<R(Args...), signal_traits::slot_storage_size>;
+  using slot = slot_node;
+  using list_allocator_type = typename std::allocator_traits<Allocator>::template rebind_traits<slot>::allocator_type;
+  using connection = slimsig::connection<concurrent_signal_base>;
+  using extended_callback = std::function<R(connection& conn, Args...)>;
+  using slot_reference = slot&;
+  using const_slot_reference = const slot&;
+  using size_type = std::size_t;
+
+  // read-only view of a snapshot for slot_call_iterator
+  class slot_list {
+  public:
+    using size_type = std::size_t;
+    slot_list(const snapshot& s) : m_snapshot(s) {};
+    size_type size() const { return m_snapshot.slots.size(); }
+    bool connected(size_type index) const {
+      return m_snapshot.slots[index]->connected.load(std::memory_order_acquire);
+    }
+    template <class... T>
+    R invoke(size_type index, T&&... args) const {
+      return m_snapshot.slots[index]->signal->call(*m_snapshot.slots[index], std::forward<T>(args)...);
+    }
+  private:
+    const snapshot& m_snapshot;
+  };
+  using slot_call_iterator = detail::slot_call_iterator<slot_list, R, Args...>;
+  static_assert(signal_traits::inline_slots == 0, "concurrent signals keep their slots in shared snapshots, not inline");
+
+  static constexpr auto arity = sizeof...(Args);
+  template <std::size_t N>
+  struct argument
+  {
+    static_assert(N < arity, "error: invalid parameter index.");
+    using type = typename std::tuple_element<N,std::tuple<Args...>>::type;
+  };
+
+  concurrent_signal_base(const allocator_type& alloc) :
+    m_current(make_snapshot(alloc)),
+    last_id(),
+    m_size(0),
+    m_running(0),
+    allocator(alloc),
+    m_retired(alloc),
+    m_reclaim_pending(false),
+    m_stats(this) {};
+
+  concurrent_signal_base(size_t capacity, const allocator_type& alloc = allocator_type{})
+  : concurrent_signal_base(alloc) {
+    m_current.load(std::memory_order_relaxed)->slots.reserve(capacity);
+  };
+
+  concurrent_signal_base(concurrent_signal_base&& other) : concurrent_signal_base(other.get_allocator()) {
+    this->swap(other);
+  }
+  concurrent_signal_base& operator=(concurrent_signal_base&& other) {
+    this->swap(other);
+    return *this;
+  }
+  concurrent_signal_base(const concurrent_signal_base&) = delete;
+  concurrent_signal_base& operator=(const concurrent_signal_base&) = delete;
+
+  void swap(concurrent_signal_base& rhs) {
+    using std::swap;
+    if (this != &rhs) {
+    #if !defined(NDEBUG) || (defined(SLIMSIG_SWAP_GUARD) && SLIMSIG_SWAP_GUARD)
+      if (is_running() || rhs.is_running())
+        throw new std::logic_error("Signals can not be swapped or moved while emitting");
+    #endif
+      dead_nodes dead { allocator };
+      std::lock(m_write_lock, rhs.m_write_lock);
+      std::lock_guard<std::mutex> lhs_guard(m_write_lock, std::adopt_lock);
+      std::lock_guard<std::mutex> rhs_guard(rhs.m_write_lock, std::adopt_lock);
+      auto current = m_current.load(std::memory_order_relaxed);
+      m_current.store(rhs.m_current.load(std::memory_order_relaxed), std::memory_order_relaxed);
+      rhs.m_current.store(current, std::memory_order_relaxed);
+      // nodes and connections remember their signal
+      rebind(m_current.load(std::memory_order_relaxed), this);
+      rebind(rhs.m_current.load(std::memory_order_relaxed), &rhs);
+      // nobody can be reading, so anything retired is free to go
+      reclaim_all(&dead.nodes);
+      rhs.reclaim_all(&dead.nodes);
+      swap(last_id, rhs.last_id);
+      auto size = m_size.load(std::memory_order_relaxed);
+      m_size.store(rhs.m_size.load(std::memory_order_relaxed), std::memory_order_relaxed);
+      rhs.m_size.store(size, std::memory_order_relaxed);
+      detail::swap_allocators(allocator, rhs.allocator);
+    }
+  }
+
+  result_type emit(Args... args) {
+    return emit_impl(std::is_same<combiner_type, last_value<void>>{}, args...);
+  }
+  result_type operator()(Args... args) {
+    return emit(std::forward<Args&&>(args)...);
+  }
+  template <class Combiner>
+  typename std::decay<Combiner>::type::result_type emit_with(Combiner&& combiner, Args... args) {
+    return combine(combiner, args...);
+  }
+
+  // see signal_base::emit_batch, every event sees the slots connected when it starts
+  template <class Iterator>
+  void emit_batch(Iterator first, Iterator last, batch_order order = batch_order::event_major) {
+    if (first == last) return;
+    read_scope scope { *this };
+    if (order == batch_order::event_major) {
+      for (; first != last; ++first) {
+        // our epoch ticket protects every snapshot published while we're reading
+        auto current = m_current.load(std::memory_order_acquire);
+        slot_list slots { *current };
+        for (size_type index = 0, end = slots.size(); index != end; index++) {
+          if (slots.connected(index)) detail::apply_lvalues(detail::batch_invoker<slot_list> { slots, index }, *first);
+        }
+      }
+    } else {
+      slot_list slots { *scope.current };
+      for (size_type index = 0, end = slots.size(); index != end; index++) {
+        for (auto event = first; event != last && slots.connected(index); ++event) {
+          detail::apply_lvalues(detail::batch_invoker<slot_list> { slots, index }, *event);
+        }
+      }
+    }
+  }
+
+  // see signal_base::emit_parallel, snapshots already make connect/disconnect from slots safe
+  void emit_parallel(Args... args) {
+    emit_parallel_on(work_stealing_pool::shared(), args...);
+  }
+  void emit_parallel_on(work_stealing_pool& pool, Args... args) {
+    read_scope scope { *this };
+    auto& slots = scope.current->slots;
+    if (slots.empty()) return;
+    auto chunks = std::min<size_type>(slots.size(), (pool.size() + 1) * 4);
+    auto chunk_size = (slots.size() + chunks - 1) / chunks;
+    pool.parallel_for(chunks, [&] (std::size_t chunk) {
+      detail::emit_trace trace { this, scope.depth };
+      for (auto index = chunk * chunk_size, last = std::min(slots.size(), index + chunk_size); index < last; index++) {
+        auto node = slots[index];
+        if (node->connected.load(std::memory_order_acquire)) call(*node, args...);
+      }
+    });
+  }
+
+  template <class F, class = typename std::enable_if<std::is_constructible<callback, F&&>::value>::type>
+  inline connection connect(F&& slot)
+  {
+    return insert(callback(std::allocator_arg, allocator, std::forward<F>(slot)), false);
+  }
+
+  template <class F, class = typename std::enable_if<std::is_constructible<callback, F&&>::value>::type>
+  connection connect_once(F&& slot)
+  {
+    return insert(callback(std::allocator_arg, allocator, std::forward<F>(slot)), true);
+  }
+
+  // the slot gets its own connection as the first argument, any callable taking (connection&, Args...)
+  // works, extended_callback included, and it's stored directly rather than through std::function
+  template <class F>
+  inline connection connect_extended(F&& slot)
+  {
+    using function_type = typename std::decay<F>::type;
+    struct extended_slot {
+      function_type fn;
+      connection conn;
+      R operator()(Args&&... args) {
+        return fn(conn, std::forward<Args>(args)...);
+      }
+    };
+    return create_connection<extended_slot>(function_type(std::forward<F>(slot)));
+  }
+
+  // calls (object->*method)(args...), the pair is kept in the slot itself and needs no allocation
+  // the object has to outlive the connection, see connect_weak
+  template <class T, class Class, class Method,
+            class = typename std::enable_if<std::is_member_function_pointer<Method Class::*>::value>::type>
+  inline connection connect(T* object, Method Class::* method)
+  {
+    return connect(detail::member_slot<T, Method Class::*> { object, method });
+  }
+
+  // like connect(object.get(), method) except the slot only holds a weak_ptr to the object
+  // and disconnects itself the first time it's called after the object is gone
+  template <class T, class Class, class Method,
+            class = typename std::enable_if<std::is_member_function_pointer<Method Class::*>::value>::type>
+  inline connection connect_weak(const std::shared_ptr<T>& object, Method Class::* method)
+  {
+    using target_type = detail::weak_member_slot<T, Method Class::*>;
+    struct weak_slot {
+      target_type target;
+      connection conn;
+      R operator()(Args&&... args) {
+        auto strong = target.object.lock();
+        if (strong) return static_cast<R>((strong.get()->*target.method)(std::forward<Args>(args)...));
+        conn.disconnect();
+        return detail::default_value<R>();
+      }
+    };
+    return create_connection<weak_slot>(target_type { object, method });
+  }
+
+  template <class TP, class Alloc>
+  inline connection connect(std::shared_ptr<signal<R(Args...), TP, Alloc>> signal) {
+    using signal_type = slimsig::signal<R(Args...), TP, Alloc>;
+    struct signal_slot {
+      std::weak_ptr<signal_type> handle;
+      connection conn;
+      R operator()(Args&&... args) {
+        auto signal = handle.lock();
+        if (signal) {
+          return signal->emit(std::forward<Args>(args)...);
+        } else {
+          conn.disconnect();
+          return detail::default_value<R>();
+        }
+      }
+    };
+    return create_connection<signal_slot>(std::move(signal));
+  }
+
+  void disconnect_all() {
+    dead_nodes dead { allocator };
+    std::lock_guard<std::mutex> guard(m_write_lock);
+    release_handles(*m_current.load(std::memory_order_relaxed));
+    m_size.store(0, std::memory_order_relaxed);
+    publish(make_snapshot(allocator), dead);
+  }
+
+  const allocator_type& get_allocator() const {
+    return allocator;
+  }
+  inline bool empty() const {
+    return slot_count() == 0;
+  }
+  inline size_type slot_count() const {
+    return m_size.load(std::memory_order_relaxed);
+  }
+  inline size_type max_size() const {
+    return std::min<size_type>(std::numeric_limits<slot_id>::max(), std::vector<slot_node*>().max_size());
+  }
+  inline size_type remaining_slots() const {
+    return max_size() - last_id;
+  }
+  // bytes this signal takes up: itself, the current snapshot and its slots, and snapshots waiting for
+  // readers to leave. Takes the writer lock
+  size_type memory_usage() const {
+    std::lock_guard<std::mutex> guard(m_write_lock);
+    auto current = m_current.load(std::memory_order_relaxed);
+    size_type bytes = sizeof(slimsig::signal<R(Args...), SignalTraits, Allocator>) + detail::allocated_bytes(m_retired);
+    bytes += sizeof(snapshot) + detail::allocated_bytes(current->slots);
+    for (auto node : current->slots) bytes += sizeof(slot_node) + node->fn.allocated_size();
+    for (auto& retired : m_retired) bytes += sizeof(snapshot) + detail::allocated_bytes(retired.value->slots);
+    return bytes;
+  }
+  size_type max_depth() const {
+    return std::numeric_limits<unsigned>::max();
+  }
+  // number of emits in progress across all threads
+  size_type get_depth() const {
+    return m_running.load(std::memory_order_relaxed);
+  }
+  bool is_running() const {
+    return get_depth() > 0;
+  }
+  signal_stats stats() const {
+    return m_stats.snapshot();
+  }
+  void set_name(std::string name) {
+    m_stats.set_name(std::move(name));
+  }
+
+  ~concurrent_signal_base() {
+    auto current = m_current.load(std::memory_order_relaxed);
+    release_handles(*current);
+    release(current);
+    reclaim_all();
+  }
+  template <class FN, class TP, class Alloc>
+  friend class signal;
+  template <class Signal>
+  friend class slimsig::connection;
+  friend class slimsig::connection_set;
+private:
+  using node_allocator = typename std::allocator_traits<allocator_type>::template rebind_alloc<slot_node>;
+  using snapshot_allocator = typename std::allocator_traits<allocator_type>::template rebind_alloc<snapshot>;
+  using node_list = std::vector<slot_node*, typename std::allocator_traits<allocator_type>::template rebind_alloc<slot_node*>>;
+  // slots a writer unlinked while holding the write lock. Declared ahead of the lock guard so they
+  // are destroyed after it unlocks, a callable's destructor may connect to or disconnect from this signal
+  struct dead_nodes {
+    explicit dead_nodes(const allocator_type& alloc) : nodes(typename node_list::allocator_type { alloc }) {};
+    dead_nodes(const dead_nodes&) = delete;
+    ~dead_nodes() { for (auto node : nodes) destroy(node); }
+    node_list nodes;
+  };
+  // nodes and snapshots keep the allocator they came from, swapping signals with unequal
+  // allocators hands them to a signal that couldn't free them otherwise
+  struct slot_node {
+    slot_node(const node_allocator& a, concurrent_signal_base* owner, slot_id sid, detail::slot_handle h, callback fn, bool fire_once)
+    : alloc(a), fn(std::move(fn)), signal(owner), id(sid), handle(h.index), connected(bool(this->fn)), once(fire_once), refs(0) {};
+    node_allocator alloc;
+    callback fn;
+    concurrent_signal_base* signal;
+    slot_id id;
+    std::uint32_t handle;
+    std::atomic<bool> connected;
+    bool once;
+    // number of snapshots holding this node, only touched with the write lock held
+    std::size_t refs;
+  };
+  struct snapshot {
+    explicit snapshot(const typename node_list::allocator_type& alloc) : slots(alloc) {};
+    node_list slots;
+  };
+  struct retired_snapshot {
+    typename detail::reader_epochs<thread_policy::reader_stripes>::epoch_type epoch;
+    snapshot* value;
+  };
+
+  struct read_scope {
+    concurrent_signal_base& signal;
+    typename detail::reader_epochs<thread_policy::reader_stripes>::ticket ticket;
+    unsigned depth;
+    const snapshot* current;
+    detail::emit_trace trace;
+    read_scope(concurrent_signal_base& context)
+    : signal(context), ticket(context.m_readers.enter()),
+      depth(context.m_running.fetch_add(1, std::memory_order_relaxed) + 1),
+      current(context.m_current.load(std::memory_order_acquire)), trace(&context, depth) {
+      signal.m_stats.on_emit(depth);
+    }
+    read_scope(const read_scope&) = delete;
+    ~read_scope() {
+      signal.m_running.fetch_sub(1, std::memory_order_relaxed);
+      signal.m_readers.leave(ticket);
+      // snapshots retired while we were reading would otherwise wait for the next connect or disconnect
+      if (signal.m_reclaim_pending.load(std::memory_order_acquire)) signal.reclaim_after_emit();
+    }
+  };
+
+  // calls a connected slot, once slots are claimed first so only one thread can fire them
+  template <class... T>
+  R call(slot_node& node, T&&... args) {
+    m_stats.on_calls(1);
+    if (node.once) {
+      if (!node.connected.exchange(false, std::memory_order_acq_rel)) return detail::default_value<R>();
+      struct remove_guard {
+        concurrent_signal_base& signal;
+        slot_id id;
+        ~remove_guard() { signal.remove(id); }
+      } guard { *this, node.id };
+      if (tracer::enabled()) return detail::traced_call(node.id, node.fn, std::forward<T>(args)...);
+      return node.fn(std::forward<T>(args)...);
+    }
+    if (tracer::enabled()) return detail::traced_call(node.id, node.fn, std::forward<T>(args)...);
+    return node.fn(std::forward<T>(args)...);
+  }
+
+  [[gnu::always_inline]]
+  inline void emit_impl(std::true_type, Args&... args) {
+    read_scope scope { *this };
+    for (auto node : scope.current->slots) {
+      if (node->connected.load(std::memory_order_acquire)) call(*node, args...);
+    }
+  }
+  [[gnu::always_inline]]
+  inline result_type emit_impl(std::false_type, Args&... args) {
+    combiner_type combiner;
+    return combine(combiner, args...);
+  }
+  template <class Combiner>
+  typename Combiner::result_type combine(Combiner& combiner, Args&... args) {
+    using state_type = detail::slot_call_state<slot_list, R, Args...>;
+    read_scope scope { *this };
+    slot_list slots { *scope.current };
+    auto end = slots.size();
+    state_type state { slots, args... };
+    return combiner(slot_call_iterator { state, 0, end }, slot_call_iterator { state, end, end });
+  }
+
+  template<class C, class T>
+  inline connection create_connection(T&& slot)
+  {
+    dead_nodes dead { allocator };
+    std::lock_guard<std::mutex> guard(m_write_lock);
+    auto sid = last_id++;
+    auto handle = acquire_handle(sid);
+    return insert_locked(make_node(sid, handle, callback(std::allocator_arg, allocator, C { std::move(slot), connection { handle } }), false), handle, dead);
+  }
+
+  connection insert(callback fn, bool once) {
+    dead_nodes dead { allocator };
+    std::lock_guard<std::mutex> guard(m_write_lock);
+    auto sid = last_id++;
+    auto handle = acquire_handle(sid);
+    return insert_locked(make_node(sid, handle, std::move(fn), once), handle, dead);
+  }
+  connection insert_locked(slot_node* node, detail::slot_handle handle, dead_nodes& dead) {
+    assert((last_id < std::numeric_limits<slot_id>::max() - 1) && "All available slot ids for this signal have been exhausted. This may be a sign you are misusing signals");
+    if (!node->connected.load(std::memory_order_relaxed)) {
+      // empty callables never connect
+      detail::handle_table::instance().release(handle.index);
+      destroy(node);
+      return {};
+    }
+    auto current = m_current.load(std::memory_order_relaxed);
+    auto next = make_snapshot(allocator);
+    next->slots.reserve(current->slots.size() + 1);
+    next->slots = current->slots;
+    next->slots.push_back(node);
+    m_size.fetch_add(1, std::memory_order_relaxed);
+    publish(next, dead);
+    return { handle };
+  }
+  // snapshots are rebuilt on every change so the handle table tracks slot ids instead of positions
+  detail::slot_handle acquire_handle(slot_id sid) {
+    return detail::handle_table::instance().acquire(static_cast<void*>(this), std::size_t(sid));
+  }
+
+  // position of the slot in the current snapshot (ids are sorted), must hold the write lock or be reading
+  static typename node_list::const_iterator find(const snapshot& s, slot_id index) {
+    auto end = s.slots.cend();
+    auto it = std::lower_bound(s.slots.cbegin(), end, index, [] (const slot_node* node, const slot_id& idx) {
+      return node->id < idx;
+    });
+    return it != end && (*it)->id == index ? it : end;
+  }
+
+  inline void disconnect(const detail::slot_handle& handle)
+  {
+    dead_nodes dead { allocator };
+    std::lock_guard<std::mutex> guard(m_write_lock);
+    auto& table = detail::handle_table::instance();
+    // the slot may have been disconnected by another thread since the connection looked us up
+    if (!table.alive(handle)) return;
+    auto current = m_current.load(std::memory_order_relaxed);
+    auto it = find(*current, slot_id(table.position(handle)));
+    if (it != current->slots.cend() && (*it)->connected.exchange(false, std::memory_order_acq_rel)) {
+      erase_locked(current, it, dead);
+    }
+  }
+  // disconnects every handle in [first, last) that is still connected, *first converts to a slot_handle.
+  // Their ids are sorted and merged against the snapshot in one pass, which publishes a single snapshot
+  // for the lot instead of copying the slot list once per connection
+  template <class Iterator>
+  void disconnect(Iterator first, Iterator last)
+  {
+    dead_nodes dead { allocator };
+    std::lock_guard<std::mutex> guard(m_write_lock);
+    auto& table = detail::handle_table::instance();
+    std::vector<slot_id, typename std::allocator_traits<allocator_type>::template rebind_alloc<slot_id>> ids(allocator);
+    for (; first != last; ++first) {
+      const detail::slot_handle& handle = *first;
+      if (table.alive(handle)) ids.push_back(slot_id(table.position(handle)));
+    }
+    if (ids.empty()) return;
+    std::sort(ids.begin(), ids.end());
+    auto current = m_current.load(std::memory_order_relaxed);
+    auto next = make_snapshot(allocator);
+    next->slots.reserve(current->slots.size());
+    auto id = ids.cbegin();
+    std::size_t removed = 0;
+    for (auto node : current->slots) {
+      while (id != ids.cend() && *id < node->id) ++id;
+      // once slots that were already claimed stay until remove() takes them out
+      if (id != ids.cend() && *id == node->id && node->connected.exchange(false, std::memory_order_acq_rel)) {
+        table.release(node->handle);
+        removed++;
+      } else {
+        next->slots.push_back(node);
+      }
+    }
+    if (removed == 0) return destroy(next);
+    m_size.fetch_sub(removed, std::memory_order_relaxed);
+    publish(next, dead);
+  }
+  // removes a once slot that has already been claimed
+  void remove(slot_id index)
+  {
+    dead_nodes dead { allocator };
+    std::lock_guard<std::mutex> guard(m_write_lock);
+    auto current = m_current.load(std::memory_order_relaxed);
+    auto it = find(*current, index);
+    if (it != current->slots.cend()) erase_locked(current, it, dead);
+  }
+  void erase_locked(snapshot* current, typename node_list::const_iterator it, dead_nodes& dead)
+  {
+    detail::handle_table::instance().release((*it)->handle);
+    auto next = make_snapshot(allocator);
+    next->slots.reserve(current->slots.size() - 1);
+    next->slots.insert(next->slots.end(), current->slots.cbegin(), it);
+    next->slots.insert(next->slots.end(), it + 1, current->slots.cend());
+    m_size.fetch_sub(1, std::memory_order_relaxed);
+    publish(next, dead);
+  }
+
+  // swaps in a new snapshot and retires the old one, must hold the write lock. Slots no snapshot
+  // holds anymore go to dead
+  void publish(snapshot* next, dead_nodes& dead)
+  {
+    for (auto node : next->slots) node->refs++;
+    auto previous = m_current.exchange(next, std::memory_order_acq_rel);
+    m_retired.push_back({ m_readers.current(), previous });
+    reclaim(dead.nodes);
+    m_reclaim_pending.store(!m_retired.empty(), std::memory_order_release);
+    // snapshots only hold live slots (and once slots about to be removed) so there's nothing to compact
+    m_stats.sample(m_size.load(std::memory_order_relaxed), next->slots.size(), next->slots.capacity());
+  }
+  // frees retired snapshots no reader can still see, must hold the write lock. Slots that were only
+  // in those snapshots are handed to dead to be destroyed once the lock is released
+  void reclaim(node_list& dead)
+  {
+    while (!m_retired.empty() && m_readers.try_advance()) {
+      auto epoch = m_readers.current();
+      auto safe = std::partition(m_retired.begin(), m_retired.end(), [&] (const retired_snapshot& retired) {
+        return !detail::reader_epochs<thread_policy::reader_stripes>::is_safe(retired.epoch, epoch);
+      });
+      for (auto it = safe; it != m_retired.end(); ++it) release(it->value, &dead);
+      m_retired.erase(safe, m_retired.end());
+    }
+  }
+  // called as an emit finishes, so a disconnected slot's callable and whatever it captured don't
+  // live on until the signal is written to again. Never waits for the lock, a writer holding it
+  // reclaims when it publishes
+  void reclaim_after_emit()
+  {
+    dead_nodes dead { allocator };
+    std::unique_lock<std::mutex> lock(m_write_lock, std::try_to_lock);
+    if (!lock) return;
+    reclaim(dead.nodes);
+    m_reclaim_pending.store(!m_retired.empty(), std::memory_order_release);
+  }
+  void reclaim_all(node_list* dead = nullptr)
+  {
+    for (auto& retired : m_retired) release(retired.value, dead);
+    m_retired.clear();
+    m_reclaim_pending.store(false, std::memory_order_relaxed);
+  }
+  static void release(snapshot* s, node_list* dead = nullptr)
+  {
+    for (auto node : s->slots) {
+      if (--node->refs != 0) continue;
+      if (dead) dead->push_back(node);
+      else destroy(node);
+    }
+    destroy(s);
+  }
+
+  template <class... T>
+  slot_node* make_node(T&&... args)
+  {
+    using traits = std::allocator_traits<node_allocator>;
+    node_allocator alloc { allocator };
+    auto node = std::addressof(*traits::allocate(alloc, 1));
+    try {
+      traits::construct(alloc, node, alloc, this, std::forward<T>(args)...);
+    } catch (...) {
+      traits::deallocate(alloc, node, 1);
+      throw;
+    }
+    return node;
+  }
+  static void destroy(slot_node* node)
+  {
+    using traits = std::allocator_traits<node_allocator>;
+    node_allocator alloc { node->alloc };
+    traits::destroy(alloc, node);
+    traits::deallocate(alloc, node, 1);
+  }
+  static snapshot* make_snapshot(const allocator_type& allocator)
+  {
+    using traits = std::allocator_traits<snapshot_allocator>;
+    snapshot_allocator alloc { allocator };
+    auto s = std::addressof(*traits::allocate(alloc, 1));
+    try {
+      traits::construct(alloc, s, typename node_list::allocator_type { allocator });
+    } catch (...) {
+      traits::deallocate(alloc, s, 1);
+      throw;
+    }
+    return s;
+  }
+  static void destroy(snapshot* s)
+  {
+    using traits = std::allocator_traits<snapshot_allocator>;
+    snapshot_allocator alloc { s->slots.get_allocator() };
+    traits::destroy(alloc, s);
+    traits::deallocate(alloc, s, 1);
+  }
+  static void rebind(snapshot* s, concurrent_signal_base* owner)
+  {
+    auto& table = detail::handle_table::instance();
+    for (auto node : s->slots) {
+      node->signal = owner;
+      table.set_owner(node->handle, static_cast<void*>(owner));
+    }
+  }
+  // every slot in the current snapshot still holds its handle, claimed once slots included
+  static void release_handles(const snapshot& s)
+  {
+    auto& table = detail::handle_table::instance();
+    for (auto node : s.slots) table.release(node->handle);
+  }
+
+  std::atomic<snapshot*> m_current;
+  slot_id last_id;
+  std::atomic<std::size_t> m_size;
+  std::atomic<unsigned> m_running;
+  allocator_type allocator;
+  mutable std::mutex m_write_lock;
+  std::vector<retired_snapshot, typename std::allocator_traits<allocator_type>::template rebind_alloc<retired_snapshot>> m_retired;
+  detail::reader_epochs<thread_policy::reader_stripes> m_readers;
+  // set while m_retired isn't empty, lets emits check without the lock
+  std::atomic<bool> m_reclaim_pending;
+  detail::signal_counters<signal_traits::instrumented> m_stats;
+};
+
+}
+
+#endif
@@ -0,0 +1,95 @@
+//
+//  epoch.h
+//  slimsig
+//
+//  Minimal epoch based reclamation for concurrent signals
+//
+
+#ifndef slimsig_epoch_h
+#define slimsig_epoch_h
+
+#include <atomic>
+#include <cstddef>
+
+namespace slimsig {
+namespace detail {
+
+/**
+ *  Two-phase reader epochs
+ *
+ *  Readers register in the current epoch (one of two parities) without taking a lock.
+ *  Writers never wait for readers: they retire whatever they unlinked with the epoch it was
+ *  unlinked in and call try_advance() when convenient. The epoch only moves forward once every
+ *  reader from the epoch before the current one has left, so anything retired in epoch E
+ *  can be freed once the epoch reaches E + 2.
+ *
+ *  Reader counts are striped across cache lines to keep emitting threads from fighting over one counter.
+ */
+template <std::size_t Stripes>
+class reader_epochs {
+  static_assert(Stripes > 0, "at least one reader stripe is required");
+public:
+  using epoch_type = unsigned;
+  struct ticket {
+    epoch_type epoch;
+    std::size_t stripe;
+  };
+
+  reader_epochs() : m_epoch(0) {
+    for (auto& stripe : m_stripes) {
+      stripe.readers[0].store(0, std::memory_order_relaxed);
+      stripe.readers[1].store(0, std::memory_order_relaxed);
+    }
+  }
+  reader_epochs(const reader_epochs&) = delete;
+  reader_epochs& operator=(const reader_epochs&) = delete;
+
+  ticket enter() {
+    auto stripe = stripe_index();
+    auto epoch = m_epoch.load(std::memory_order_seq_cst);
+    for (;;) {
+      m_stripes[stripe].readers[epoch & 1].fetch_add(1, std::memory_order_seq_cst);
+      auto current = m_epoch.load(std::memory_order_seq_cst);
+      if (current == epoch) return { epoch, stripe };
+      m_stripes[stripe].readers[epoch & 1].fetch_sub(1, std::memory_order_release);
+      epoch = current;
+    }
+  }
+  void leave(const ticket& t) {
+    m_stripes[t.stripe].readers[t.epoch & 1].fetch_sub(1, std::memory_order_release);
+  }
+
+  // writer side
+  epoch_type current() const {
+    return m_epoch.load(std::memory_order_seq_cst);
+  }
+  // moves to the next epoch if nobody is still reading in the previous one
+  bool try_advance() {
+    auto epoch = m_epoch.load(std::memory_order_seq_cst);
+    auto parity = (epoch + 1) & 1;
+    for (auto& stripe : m_stripes) {
+      if (stripe.readers[parity].load(std::memory_order_acquire) != 0) return false;
+    }
+    m_epoch.store(epoch + 1, std::memory_order_seq_cst);
+    return true;
+  }
+  static bool is_safe(epoch_type retired, epoch_type current) {
+    return epoch_type(current - retired) >= 2;
+  }
+private:
+  static std::size_t stripe_index() {
+    static std::atomic<std::size_t> next_stripe { 0 };
+    static thread_local std::size_t stripe = next_stripe.fetch_add(1, std::memory_order_relaxed) % Stripes;
+    return stripe;
+  }
+  struct alignas(64) stripe_type {
+    std::atomic<std::size_t> readers[2];
+  };
+  std::atomic<epoch_type> m_epoch;
+  stripe_type m_stripes[Stripes];
+};
+
+}
+}
+
+#endif
@@ -0,0 +1,216 @@
+//
+//  handle_table.h
+//  slimsig
+//
+//  Generational handles that connections use to find their slot
+//
+
+#ifndef slimsig_handle_table_h
+#define slimsig_handle_table_h
+
+#include <atomic>
+#include <cstdint>
+#include <cstddef>
+#include <mutex>
+#include <cassert>
+
+namespace slimsig {
+namespace detail {
+
+/**
+ *  A connection is an index into a process wide table plus the generation that entry had when
+ *  the slot was connected. Every time an entry is handed out or given back its generation is
+ *  bumped, so checking whether a connection is still connected is a single load and compare,
+ *  and it stays safe after the signal is gone because signals give back their entries when
+ *  they're destroyed.
+ *
+ *  Each live entry remembers the signal that owns it and where the slot currently lives inside
+ *  that signal, which the signal keeps up to date whenever it moves slots around. That makes
+ *  disconnect O(1) as well.
+ *
+ *  Generations are 32 bits so a connection stays the size of a pointer. An entry whose generation
+ *  would wrap is retired instead of reused, otherwise a connection kept around for 2^31 reuses
+ *  of its entry would come back to life pointing at somebody else's slot.
+ *
+ *  The table is made of fixed size chunks that are never freed or moved, so entries can be read
+ *  without locking. Free entries are cached per thread; the global lock is only taken to move
+ *  batches of entries between a thread's cache and the shared free list.
+ */
+struct slot_handle {
+  static constexpr std::uint32_t invalid_index = ~std::uint32_t(0);
+  slot_handle() : index(invalid_index), generation(0) {};
+  slot_handle(std::uint32_t idx, std::uint32_t gen) : index(idx), generation(gen) {};
+  std::uint32_t index;
+  std::uint32_t generation;
+};
+
+class handle_table {
+public:
+  struct entry {
+    // odd while the entry is in use
+    std::atomic<std::uint32_t> generation;
+    std::uint32_t next_free;
+    std::atomic<void*> owner;
+    std::atomic<std::size_t> position;
+  };
+
+  static constexpr std::uint32_t chunk_bits = 14;
+  static constexpr std::uint32_t chunk_size = 1u << chunk_bits;
+  static constexpr std::uint32_t max_chunks = 1u << 18;
+  static constexpr std::uint32_t batch_size = 64;
+
+  constexpr handle_table() : m_chunks{}, m_next_unused(0), m_free_head(slot_handle::invalid_index), m_lock() {};
+  handle_table(const handle_table&) = delete;
+  handle_table& operator=(const handle_table&) = delete;
+  // chunks are intentionally never freed, connections in static objects may outlive the table
+
+  static handle_table& instance() { return storage<>::table; }
+
+  [[gnu::always_inline]]
+  inline entry& at(std::uint32_t index) const {
+    return m_chunks[index >> chunk_bits].load(std::memory_order_acquire)[index & (chunk_size - 1)];
+  }
+
+  [[gnu::always_inline]]
+  inline bool alive(const slot_handle& handle) const {
+    return handle.index != slot_handle::invalid_index &&
+           at(handle.index).generation.load(std::memory_order_acquire) == handle.generation;
+  }
+
+  // the signal that owns a live handle, or nullptr
+  [[gnu::always_inline]]
+  inline void* owner(const slot_handle& handle) const {
+    if (!alive(handle)) return nullptr;
+    return at(handle.index).owner.load(std::memory_order_relaxed);
+  }
+
+  [[gnu::always_inline]]
+  inline std::size_t position(const slot_handle& handle) const {
+    return at(handle.index).position.load(std::memory_order_relaxed);
+  }
+
+  slot_handle acquire(void* owner, std::size_t position) {
+    std::uint32_t index;
+    if (auto cache = local_cache()) {
+      if (cache->count == 0) refill(*cache);
+      index = cache->head;
+      cache->head = at(index).next_free;
+      cache->count--;
+    } else {
+      std::lock_guard<std::mutex> guard(m_lock);
+      index = take_free();
+    }
+    auto& e = at(index);
+    e.owner.store(owner, std::memory_order_relaxed);
+    e.position.store(position, std::memory_order_relaxed);
+    auto generation = e.generation.load(std::memory_order_relaxed) + 1;
+    e.generation.store(generation, std::memory_order_release);
+    return { index, generation };
+  }
+
+  [[gnu::always_inline]]
+  inline void relocate(std::uint32_t index, std::size_t position) {
+    at(index).position.store(position, std::memory_order_relaxed);
+  }
+  [[gnu::always_inline]]
+  inline void set_owner(std::uint32_t index, void* owner) {
+    at(index).owner.store(owner, std::memory_order_relaxed);
+  }
+
+  // gives an entry back, invalidating every connection that refers to it
+  void release(std::uint32_t index) {
+    auto& e = at(index);
+    auto generation = e.generation.load(std::memory_order_relaxed) + 1;
+    e.generation.store(generation, std::memory_order_release);
+    e.owner.store(nullptr, std::memory_order_relaxed);
+    // wrapped around, every generation this entry could hand out again has been used before
+    if (generation == 0) return;
+    if (auto cache = local_cache()) {
+      e.next_free = cache->head;
+      cache->head = index;
+      if (++cache->count > 2 * batch_size) drain(*cache, batch_size);
+    } else {
+      std::lock_guard<std::mutex> guard(m_lock);
+      e.next_free = m_free_head;
+      m_free_head = index;
+    }
+  }
+private:
+  template <class = void>
+  struct storage {
+    static handle_table table;
+  };
+
+  struct free_cache {
+    std::uint32_t head = slot_handle::invalid_index;
+    std::uint32_t count = 0;
+    ~free_cache() {
+      if (count) instance().drain(*this, count);
+      cache_destroyed() = true;
+    }
+  };
+  // trivially destructible, so it can still be read after the cache is gone
+  static bool& cache_destroyed() {
+    static thread_local bool destroyed = false;
+    return destroyed;
+  }
+  // nullptr once this thread's cache has been destroyed, signals with static or thread storage
+  // duration may still connect or disconnect after that and go straight to the shared free list
+  static free_cache* local_cache() {
+    if (cache_destroyed()) return nullptr;
+    static thread_local free_cache cache;
+    return &cache;
+  }
+
+  // moves count entries from the cache to the shared free list
+  void drain(free_cache& cache, std::uint32_t count) {
+    auto first = cache.head;
+    auto last = first;
+    for (std::uint32_t i = 1; i < count; i++) last = at(last).next_free;
+    cache.head = at(last).next_free;
+    cache.count -= count;
+    std::lock_guard<std::mutex> guard(m_lock);
+    at(last).next_free = m_free_head;
+    m_free_head = first;
+  }
+
+  // takes a batch of entries from the shared free list, or from fresh chunks if it's empty
+  void refill(free_cache& cache) {
+    std::lock_guard<std::mutex> guard(m_lock);
+    for (std::uint32_t i = 0; i < batch_size; i++) {
+      auto index = take_free();
+      at(index).next_free = cache.head;
+      cache.head = index;
+      cache.count++;
+    }
+  }
+
+  // one entry off the shared free list, or from fresh chunks if it's empty, must hold m_lock
+  std::uint32_t take_free() {
+    if (m_free_head != slot_handle::invalid_index) {
+      auto index = m_free_head;
+      m_free_head = at(index).next_free;
+      return index;
+    }
+    auto index = m_next_unused++;
+    auto chunk = index >> chunk_bits;
+    assert(chunk < max_chunks && "slot handle table exhausted");
+    if (m_chunks[chunk].load(std::memory_order_relaxed) == nullptr) {
+      m_chunks[chunk].store(new entry[chunk_size](), std::memory_order_release);
+    }
+    return index;
+  }
+
+  std::atomic<entry*> m_chunks[max_chunks];
+  std::uint32_t m_next_unused;
+  std::uint32_t m_free_head;
+  std::mutex m_lock;
+};
+
+template <class T>
+handle_table handle_table::storage<T>::table;
+
+}
+}
+
+#endif
@@ -0,0 +1,111 @@
+//
+//  inline_allocator.h
+//  slimsig
+//
+//  Allocator that serves one allocation at a time out of a buffer owned by someone else
+//
+
+#ifndef slimsig_inline_allocator_h
+#define slimsig_inline_allocator_h
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <type_traits>
+
+namespace slimsig {
+namespace detail {
+
+// a buffer that can hold a single allocation, usually embedded in the object that owns the container
+struct inline_buffer {
+  unsigned char* data;
+  std::size_t size;
+  bool in_use;
+};
+
+/**
+ *  Hands out the inline buffer when it's free and big enough, otherwise falls back to Upstream
+ *
+ *  A vector using this allocator lives inline until it outgrows the buffer, and the buffer becomes
+ *  available again as soon as the vector (or whoever the vector gave its storage to) releases it.
+ *  Allocators are only equal when they share a buffer, so containers using different buffers
+ *  must exchange elements rather than storage.
+ */
+template <class T, class Upstream = std::allocator<T>>
+class inline_allocator {
+  using upstream_traits = typename std::allocator_traits<Upstream>::template rebind_traits<T>;
+  using upstream_type = typename upstream_traits::allocator_type;
+public:
+  using value_type = T;
+  using propagate_on_container_copy_assignment = std::false_type;
+  using propagate_on_container_move_assignment = std::false_type;
+  using propagate_on_container_swap = std::false_type;
+  template <class U>
+  struct rebind { using other = inline_allocator<U, typename std::allocator_traits<Upstream>::template rebind_alloc<U>>; };
+
+  inline_allocator(inline_buffer* buffer, const Upstream& upstream = Upstream()) : m_buffer(buffer), m_upstream(upstream) {};
+  template <class U, class UpstreamU>
+  inline_allocator(const inline_allocator<U, UpstreamU>& other) : m_buffer(other.m_buffer), m_upstream(other.m_upstream) {};
+
+  T* allocate(std::size_t n)
+  {
+    if (!m_buffer->in_use && n * sizeof(T) <= m_buffer->size &&
+        reinterpret_cast<std::uintptr_t>(m_buffer->data) % alignof(T) == 0) {
+      m_buffer->in_use = true;
+      return reinterpret_cast<T*>(m_buffer->data);
+    }
+    return std::addressof(*upstream_traits::allocate(m_upstream, n));
+  }
+  void deallocate(T* p, std::size_t n)
+  {
+    if (reinterpret_cast<unsigned char*>(p) == m_buffer->data) {
+      m_buffer->in_use = false;
+    } else {
+      upstream_traits::deallocate(m_upstream, p, n);
+    }
+  }
+  const upstream_type& upstream() const { return m_upstream; }
+
+  template <class U, class UpstreamU>
+  bool operator==(const inline_allocator<U, UpstreamU>& other) const {
+    return m_buffer == other.m_buffer && m_upstream == other.m_upstream;
+  }
+  template <class U, class UpstreamU>
+  bool operator!=(const inline_allocator<U, UpstreamU>& other) const { return !(*this == other); }
+private:
+  template <class U, class UpstreamU>
+  friend class inline_allocator;
+  inline_buffer* m_buffer;
+  upstream_type m_upstream;
+};
+
+// room for N values of T plus the bookkeeping an inline_allocator needs, not copyable or movable
+// since allocators point into it. Allocations that don't fit go to Upstream
+template <class T, std::size_t N, class Upstream = std::allocator<T>>
+class inline_storage {
+public:
+  using allocator_type = inline_allocator<T, Upstream>;
+  inline_storage() : m_buffer { reinterpret_cast<unsigned char*>(&m_storage), sizeof(m_storage), false } {};
+  inline_storage(const inline_storage&) = delete;
+  inline_storage& operator=(const inline_storage&) = delete;
+  allocator_type allocator(const Upstream& upstream) { return allocator_type(&m_buffer, upstream); }
+  // true if p is the inline buffer, memory there isn't allocated from anywhere
+  bool owns(const void* p) const { return p == static_cast<const void*>(&m_storage); }
+private:
+  typename std::aligned_storage<sizeof(T) * N, alignof(T)>::type m_storage;
+  inline_buffer m_buffer;
+};
+
+template <class T, class Upstream>
+class inline_storage<T, 0, Upstream> {
+public:
+  using allocator_type = typename std::allocator_traits<Upstream>::template rebind_alloc<T>;
+  allocator_type allocator(const Upstream& upstream) { return allocator_type(upstream); }
+  bool owns(const void*) const { return false; }
+};
+
+}
+}
+
+#endif
@@ -0,0 +1,301 @@
+//
+//  inplace_function.h
+//  slimsig
+//
+//  Small-buffer callable storage used by basic_slot
+//
+
+#ifndef slimsig_inplace_function_h
+#define slimsig_inplace_function_h
+
+#include <cstddef>
+#include <cassert>
+#include <functional>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace slimsig {
+namespace detail {
+
+template <class T>
+struct voider { using type = void; };
+
+template <class F, class Signature, class = void>
+struct is_invocable_r : std::false_type {};
+
+template <class F, class R, class... Args>
+struct is_invocable_r<F, R(Args...), typename voider<decltype(std::declval<F>()(std::declval<Args>()...))>::type>
+  : std::integral_constant<bool,
+      std::is_void<R>::value ||
+      std::is_convertible<decltype(std::declval<F>()(std::declval<Args>()...)), R>::value> {};
+
+// empty function pointers/std::functions produce empty slots, just like std::function does
+template <class F>
+[[gnu::always_inline]] inline bool is_null_callable(const F&) { return false; }
+template <class F>
+[[gnu::always_inline]] inline bool is_null_callable(F* fn) { return fn == nullptr; }
+template <class Signature>
+[[gnu::always_inline]] inline bool is_null_callable(const std::function<Signature>& fn) { return !fn; }
+
+/**
+ *  Type erased callable that stores targets up to Capacity bytes inside the object itself
+ *  and falls back to the heap for anything larger (or anything that can throw while being moved)
+ *
+ *  Unlike std::function the buffer size is a template parameter, so signal_traits can pick
+ *  a size that fits the lambdas an application actually connects. Copies and moves go through a
+ *  single static table per target type so the only indirection on invocation is one function pointer.
+ */
+template <class Signature, std::size_t Capacity, std::size_t Alignment = alignof(void*)>
+class inplace_function;
+
+template <class R, class... Args, std::size_t Capacity, std::size_t Alignment>
+class inplace_function<R(Args...), Capacity, Alignment> {
+  static constexpr std::size_t buffer_size = Capacity < sizeof(void*) ? sizeof(void*) : Capacity;
+  static constexpr std::size_t buffer_alignment = Alignment < alignof(void*) ? alignof(void*) : Alignment;
+  using storage_type = typename std::aligned_storage<buffer_size, buffer_alignment>::type;
+
+  struct vtable_type {
+    R (*invoke)(const storage_type&, Args&&...);
+    void (*copy)(storage_type&, const storage_type&);
+    void (*move)(storage_type&, storage_type&);
+    void (*destroy)(storage_type&);
+    bool is_inline;
+    // bytes the target took from the heap, see allocated_size
+    std::size_t heap_size;
+  };
+
+  template <class F>
+  struct inline_target {
+    static F& get(const storage_type& s) { return *const_cast<F*>(reinterpret_cast<const F*>(&s)); }
+    static R invoke(const storage_type& s, Args&&... args) { return get(s)(std::forward<Args>(args)...); }
+    static void copy(storage_type& dst, const storage_type& src) { ::new (&dst) F(get(src)); }
+    static void move(storage_type& dst, storage_type& src) { ::new (&dst) F(std::move(get(src))); get(src).~F(); }
+    static void destroy(storage_type& s) { get(s).~F(); }
+    [[gnu::always_inline]]
+    static inline const vtable_type* vtable() {
+      static const vtable_type table { &invoke, &copy, &move, &destroy, true, 0 };
+      return &table;
+    }
+  };
+  // plain function pointers with exactly our signature, called directly rather than through invoke
+  using function_pointer = R (*)(Args...);
+  using function_pointer_target = inline_target<function_pointer>;
+
+  template <class F>
+  struct heap_target {
+    static F*& get(const storage_type& s) { return *const_cast<F**>(reinterpret_cast<F* const*>(&s)); }
+    static R invoke(const storage_type& s, Args&&... args) { return (*get(s))(std::forward<Args>(args)...); }
+    static void copy(storage_type& dst, const storage_type& src) { ::new (&dst) F*(new F(*get(src))); }
+    static void move(storage_type& dst, storage_type& src) { ::new (&dst) F*(get(src)); get(src) = nullptr; }
+    static void destroy(storage_type& s) { delete get(s); }
+    static const vtable_type* vtable() {
+      static const vtable_type table { &invoke, &copy, &move, &destroy, false, sizeof(F) };
+      return &table;
+    }
+  };
+
+  // heap target allocated through a user allocator, the block keeps a copy of the allocator
+  // so copies and the eventual deallocation don't need to know where it came from
+  template <class F, class Alloc>
+  struct allocated_target {
+    struct block {
+      template <class... T>
+      block(const Alloc& a, T&&... args) : alloc(a), fn(std::forward<T>(args)...) {};
+      Alloc alloc;
+      F fn;
+    };
+    using block_allocator = typename std::allocator_traits<Alloc>::template rebind_alloc<block>;
+    using block_traits = std::allocator_traits<block_allocator>;
+    template <class... T>
+    static void create(storage_type& dst, const Alloc& alloc, T&&... args) {
+      block_allocator a(alloc);
+      auto p = block_traits::allocate(a, 1);
+      try {
+        ::new (static_cast<void*>(std::addressof(*p))) block(alloc, std::forward<T>(args)...);
+      } catch (...) {
+        block_traits::deallocate(a, p, 1);
+        throw;
+      }
+      ::new (&dst) block*(std::addressof(*p));
+    }
+    static block*& get(const storage_type& s) { return *const_cast<block**>(reinterpret_cast<block* const*>(&s)); }
+    static R invoke(const storage_type& s, Args&&... args) { return get(s)->fn(std::forward<Args>(args)...); }
+    static void copy(storage_type& dst, const storage_type& src) { create(dst, get(src)->alloc, get(src)->fn); }
+    static void move(storage_type& dst, storage_type& src) { ::new (&dst) block*(get(src)); get(src) = nullptr; }
+    static void destroy(storage_type& s) {
+      auto p = get(s);
+      block_allocator a(p->alloc);
+      p->~block();
+      block_traits::deallocate(a, p, 1);
+    }
+    static const vtable_type* vtable() {
+      static const vtable_type table { &invoke, &copy, &move, &destroy, false, sizeof(block) };
+      return &table;
+    }
+  };
+
+  template <class F>
+  struct fits_inline : std::integral_constant<bool,
+    sizeof(F) <= buffer_size &&
+    buffer_alignment % alignof(F) == 0 &&
+    std::is_nothrow_move_constructible<F>::value> {};
+
+  template <class F>
+  using enable_if_target = typename std::enable_if<
+    !std::is_same<typename std::decay<F>::type, inplace_function>::value &&
+    !std::is_same<typename std::decay<F>::type, std::nullptr_t>::value &&
+    is_invocable_r<typename std::decay<F>::type&, R(Args...)>::value
+  >::type;
+
+  template <class F>
+  void assign(F&& fn, std::true_type /* inline */) {
+    using target = typename std::decay<F>::type;
+    ::new (&m_storage) target(std::forward<F>(fn));
+    m_vtable = inline_target<target>::vtable();
+  }
+  template <class F>
+  void assign(F&& fn, std::false_type /* inline */) {
+    using target = typename std::decay<F>::type;
+    ::new (&m_storage) target*(new target(std::forward<F>(fn)));
+    m_vtable = heap_target<target>::vtable();
+  }
+  template <class F, class Alloc>
+  void assign(F&& fn, const Alloc&, std::true_type /* inline */) {
+    assign(std::forward<F>(fn), std::true_type{});
+  }
+  template <class F, class Alloc>
+  void assign(F&& fn, const Alloc& alloc, std::false_type /* inline */) {
+    assign_allocated(std::forward<F>(fn), alloc, is_std_allocator<Alloc>{});
+  }
+  template <class F, class Alloc>
+  void assign_allocated(F&& fn, const Alloc&, std::true_type /* std::allocator */) {
+    assign(std::forward<F>(fn), std::false_type{});
+  }
+  template <class F, class Alloc>
+  void assign_allocated(F&& fn, const Alloc& alloc, std::false_type /* std::allocator */) {
+    using target = typename std::decay<F>::type;
+    allocated_target<target, Alloc>::create(m_storage, alloc, std::forward<F>(fn));
+    m_vtable = allocated_target<target, Alloc>::vtable();
+  }
+  template <class Alloc>
+  struct is_std_allocator : std::is_same<Alloc, std::allocator<typename std::allocator_traits<Alloc>::value_type>> {};
+public:
+  using result_type = R;
+  static constexpr std::size_t capacity = buffer_size;
+
+  inplace_function() noexcept : m_vtable(nullptr) {};
+  inplace_function(std::nullptr_t) noexcept : m_vtable(nullptr) {};
+
+  template <class F, class = enable_if_target<F>>
+  inplace_function(F&& fn) : m_vtable(nullptr) {
+    using target = typename std::decay<F>::type;
+    static_assert(std::is_copy_constructible<target>::value, "slot callables must be CopyConstructible");
+    if (!is_null_callable(fn)) assign(std::forward<F>(fn), fits_inline<target>{});
+  }
+
+  // targets that don't fit inline are allocated with alloc instead of operator new
+  template <class Alloc, class F, class = enable_if_target<F>>
+  inplace_function(std::allocator_arg_t, const Alloc& alloc, F&& fn) : m_vtable(nullptr) {
+    using target = typename std::decay<F>::type;
+    static_assert(std::is_copy_constructible<target>::value, "slot callables must be CopyConstructible");
+    if (!is_null_callable(fn)) assign(std::forward<F>(fn), alloc, fits_inline<target>{});
+  }
+  // already type erased, whoever built it picked the allocator
+  template <class Alloc>
+  inplace_function(std::allocator_arg_t, const Alloc&, inplace_function&& other) noexcept : inplace_function(std::move(other)) {};
+  template <class Alloc>
+  inplace_function(std::allocator_arg_t, const Alloc&, const inplace_function& other) : inplace_function(other) {};
+  template <class Alloc>
+  inplace_function(std::allocator_arg_t, const Alloc&, std::nullptr_t) noexcept : m_vtable(nullptr) {};
+
+  inplace_function(const inplace_function& other) : m_vtable(other.m_vtable) {
+    if (m_vtable) m_vtable->copy(m_storage, other.m_storage);
+  }
+  inplace_function(inplace_function&& other) noexcept : m_vtable(other.m_vtable) {
+    if (m_vtable) {
+      m_vtable->move(m_storage, other.m_storage);
+      other.m_vtable = nullptr;
+    }
+  }
+  inplace_function& operator=(const inplace_function& rhs) {
+    if (this != &rhs) {
+      inplace_function tmp(rhs);
+      *this = std::move(tmp);
+    }
+    return *this;
+  }
+  inplace_function& operator=(inplace_function&& rhs) noexcept {
+    if (this != &rhs) {
+      reset();
+      if (rhs.m_vtable) {
+        rhs.m_vtable->move(m_storage, rhs.m_storage);
+        m_vtable = rhs.m_vtable;
+        rhs.m_vtable = nullptr;
+      }
+    }
+    return *this;
+  }
+  inplace_function& operator=(std::nullptr_t) noexcept {
+    reset();
+    return *this;
+  }
+  template <class F, class = enable_if_target<F>>
+  inplace_function& operator=(F&& fn) {
+    return *this = inplace_function(std::forward<F>(fn));
+  }
+  ~inplace_function() { reset(); }
+
+  void swap(inplace_function& other) noexcept {
+    inplace_function tmp(std::move(other));
+    other = std::move(*this);
+    *this = std::move(tmp);
+  }
+
+  [[gnu::always_inline]]
+  inline explicit operator bool() const noexcept { return m_vtable != nullptr; }
+  // true if the target lives in the inline buffer (false for empty or heap allocated targets)
+  [[gnu::always_inline]]
+  inline bool stored_inline() const noexcept { return m_vtable != nullptr && m_vtable->is_inline; }
+  // bytes allocated for a target that didn't fit inline, 0 for inline and empty ones
+  inline std::size_t allocated_size() const noexcept { return m_vtable != nullptr ? m_vtable->heap_size : 0; }
+  // the target if it's an F stored inline, like std::function::target except heap targets aren't found
+  template <class F>
+  [[gnu::always_inline]]
+  inline const F* target() const noexcept {
+    return m_vtable == inline_target<F>::vtable() ? &inline_target<F>::get(m_storage) : nullptr;
+  }
+
+  [[gnu::always_inline]]
+  inline R operator()(Args... args) const {
+    assert(m_vtable && "called an empty inplace_function");
+    // checking for the most common target costs a compare and saves a trip through a thunk.
+    // Member slots go through the thunk, each object type and method signature is a target type of
+    // its own so there's no single vtable to compare against
+    if (m_vtable == function_pointer_target::vtable()) {
+      return function_pointer_target::get(m_storage)(std::forward<Args>(args)...);
+    }
+    return m_vtable->invoke(m_storage, std::forward<Args>(args)...);
+  }
+private:
+  [[gnu::always_inline]]
+  inline void reset() noexcept {
+    if (m_vtable) {
+      m_vtable->destroy(m_storage);
+      m_vtable = nullptr;
+    }
+  }
+  storage_type m_storage;
+  const vtable_type* m_vtable;
+};
+
+template <class Signature, std::size_t Capacity, std::size_t Alignment>
+inline void swap(inplace_function<Signature, Capacity, Alignment>& lhs, inplace_function<Signature, Capacity, Alignment>& rhs) noexcept {
+  lhs.swap(rhs);
+}
+
+}
+}
+
+#endif
@@ -0,0 +1,212 @@
+//
+//  instrumentation.h
+//  slimsig
+//
+//  Optional per-signal counters, enabled with signal_traits::instrumented
+//
+
+#ifndef slimsig_instrumentation_h
+#define slimsig_instrumentation_h
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <algorithm>
+
+namespace slimsig {
+
+class signal_registry;
+
+// a copy of one signal's counters, all zero for signals that aren't instrumented
+struct signal_stats {
+  // address of the signal, stable for its lifetime
+  const void* signal = nullptr;
+  std::string name;
+  std::uint64_t emits = 0;
+  std::uint64_t slot_calls = 0;
+  unsigned max_depth = 0;
+  std::uint64_t compactions = 0;
+  std::uint64_t compaction_ns = 0;
+  // the gauges below are sampled whenever slots are connected or disconnected and after every outermost emit
+  std::size_t slots = 0;
+  // disconnected slots still taking up space until the next compaction
+  std::size_t tombstones = 0;
+  std::size_t capacity = 0;
+};
+
+namespace detail {
+
+template <bool Enabled>
+class signal_counters;
+
+// everything compiles away for signals that aren't instrumented
+template <>
+class signal_counters<false> {
+public:
+  signal_counters(const void*) {};
+  // the empty destructor keeps "auto timer = time_compaction();" from warning about an unused variable
+  struct compaction_timer { ~compaction_timer() {} };
+  [[gnu::always_inline]] inline void on_emit(unsigned) {}
+  [[gnu::always_inline]] inline void on_calls(std::uint64_t) {}
+  [[gnu::always_inline]] inline compaction_timer time_compaction() { return {}; }
+  [[gnu::always_inline]] inline void sample(std::size_t, std::size_t, std::size_t) {}
+  [[gnu::always_inline]] inline void set_name(std::string) {}
+  signal_stats snapshot() const { return {}; }
+};
+
+/**
+ *  Counters for one signal, registered with signal_registry for as long as the signal lives
+ *
+ *  Counters are relaxed atomics so the registry can read them from any thread while the signal is
+ *  being emitted. They're only ever written by threads that are allowed to touch the signal, so
+ *  for single threaded signals the increments never contend.
+ */
+template <>
+class signal_counters<true> {
+public:
+  signal_counters(const void* owner);
+  signal_counters(const signal_counters&) = delete;
+  signal_counters& operator=(const signal_counters&) = delete;
+  ~signal_counters();
+
+  struct compaction_timer {
+    signal_counters* counters;
+    std::chrono::steady_clock::time_point start;
+    compaction_timer(signal_counters& c) : counters(&c), start(std::chrono::steady_clock::now()) {};
+    compaction_timer(compaction_timer&& other) : counters(other.counters), start(other.start) {
+      other.counters = nullptr;
+    }
+    ~compaction_timer() {
+      if (!counters) return;
+      auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start);
+      counters->m_compactions.fetch_add(1, std::memory_order_relaxed);
+      counters->m_compaction_ns.fetch_add(std::uint64_t(elapsed.count()), std::memory_order_relaxed);
+    }
+  };
+
+  [[gnu::always_inline]]
+  inline void on_emit(unsigned depth) {
+    m_emits.fetch_add(1, std::memory_order_relaxed);
+    auto max = m_max_depth.load(std::memory_order_relaxed);
+    while (depth > max && !m_max_depth.compare_exchange_weak(max, depth, std::memory_order_relaxed)) {}
+  }
+  [[gnu::always_inline]]
+  inline void on_calls(std::uint64_t calls) {
+    m_slot_calls.fetch_add(calls, std::memory_order_relaxed);
+  }
+  [[gnu::always_inline]]
+  inline compaction_timer time_compaction() {
+    return { *this };
+  }
+  [[gnu::always_inline]]
+  inline void sample(std::size_t slots, std::size_t stored, std::size_t capacity) {
+    m_slots.store(slots, std::memory_order_relaxed);
+    m_tombstones.store(stored - slots, std::memory_order_relaxed);
+    m_capacity.store(capacity, std::memory_order_relaxed);
+  }
+  void set_name(std::string name);
+  signal_stats snapshot() const;
+private:
+  friend class slimsig::signal_registry;
+  signal_stats snapshot_locked() const;
+  const void* m_owner;
+  std::string m_name;
+  std::atomic<std::uint64_t> m_emits;
+  std::atomic<std::uint64_t> m_slot_calls;
+  std::atomic<unsigned> m_max_depth;
+  std::atomic<std::uint64_t> m_compactions;
+  std::atomic<std::uint64_t> m_compaction_ns;
+  std::atomic<std::size_t> m_slots;
+  std::atomic<std::size_t> m_tombstones;
+  std::atomic<std::size_t> m_capacity;
+};
+
+}
+
+/**
+ *  Every live instrumented signal in the process
+ */
+class signal_registry {
+public:
+  // copies the counters of every instrumented signal
+  static std::vector<signal_stats> snapshot() {
+    auto& registry = instance();
+    std::lock_guard<std::mutex> guard(registry.m_lock);
+    std::vector<signal_stats> stats;
+    stats.reserve(registry.m_signals.size());
+    for (auto counters : registry.m_signals) stats.push_back(counters->snapshot_locked());
+    return stats;
+  }
+  template <class F>
+  static void for_each(F&& fn) {
+    for (auto& stats : snapshot()) fn(stats);
+  }
+private:
+  friend class detail::signal_counters<true>;
+  // never destroyed so signals with static storage can unregister at exit
+  static signal_registry& instance() {
+    static signal_registry* registry = new signal_registry();
+    return *registry;
+  }
+
+  std::mutex m_lock;
+  std::vector<const detail::signal_counters<true>*> m_signals;
+};
+
+namespace detail {
+
+inline signal_counters<true>::signal_counters(const void* owner)
+: m_owner(owner), m_name(), m_emits(0), m_slot_calls(0), m_max_depth(0), m_compactions(0),
+  m_compaction_ns(0), m_slots(0), m_tombstones(0), m_capacity(0)
+{
+  auto& registry = signal_registry::instance();
+  std::lock_guard<std::mutex> guard(registry.m_lock);
+  registry.m_signals.push_back(this);
+}
+
+inline signal_counters<true>::~signal_counters()
+{
+  auto& registry = signal_registry::instance();
+  std::lock_guard<std::mutex> guard(registry.m_lock);
+  auto& signals = registry.m_signals;
+  signals.erase(std::remove(signals.begin(), signals.end(), this), signals.end());
+}
+
+// the name is guarded by the registry lock so snapshots never see it half written
+inline void signal_counters<true>::set_name(std::string name)
+{
+  std::lock_guard<std::mutex> guard(signal_registry::instance().m_lock);
+  m_name = std::move(name);
+}
+
+inline signal_stats signal_counters<true>::snapshot() const
+{
+  std::lock_guard<std::mutex> guard(signal_registry::instance().m_lock);
+  return snapshot_locked();
+}
+
+inline signal_stats signal_counters<true>::snapshot_locked() const
+{
+  signal_stats stats;
+  stats.signal = m_owner;
+  stats.name = m_name;
+  stats.emits = m_emits.load(std::memory_order_relaxed);
+  stats.slot_calls = m_slot_calls.load(std::memory_order_relaxed);
+  stats.max_depth = m_max_depth.load(std::memory_order_relaxed);
+  stats.compactions = m_compactions.load(std::memory_order_relaxed);
+  stats.compaction_ns = m_compaction_ns.load(std::memory_order_relaxed);
+  stats.slots = m_slots.load(std::memory_order_relaxed);
+  stats.tombstones = m_tombstones.load(std::memory_order_relaxed);
+  stats.capacity = m_capacity.load(std::memory_order_relaxed);
+  return stats;
+}
+
+}
+
+}
+
+#endif
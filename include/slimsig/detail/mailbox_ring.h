@@ -0,0 +1,200 @@
+//
+//  mailbox_ring.h
+//  slimsig
+//
+//  Bounded lock-free ring that many threads push into and one thread drains
+//
+
+#ifndef slimsig_mailbox_ring_h
+#define slimsig_mailbox_ring_h
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace slimsig {
+namespace detail {
+
+/**
+ *  Fixed capacity ring of T with a sequence number per cell
+ *
+ *  A cell's sequence says whose turn it is: equal to a producer's position means the cell is free
+ *  for that producer, one past a position means the value is published and can be taken. Producers
+ *  and takers each claim positions with a compare and swap, so pushing never takes a lock and
+ *  a full ring is noticed without waiting on anyone.
+ *
+ *  There is one owner that drains the ring with claim()/release(), which keeps the claimed values
+ *  in place until it's done with them. Producers may also take the oldest value with drop_oldest()
+ *  to make room, that's the only reason taking is a compare and swap rather than a plain store.
+ */
+template <class T, class Allocator = std::allocator<T>>
+class mailbox_ring {
+  struct cell {
+    std::atomic<std::size_t> sequence;
+    typename std::aligned_storage<sizeof(T), alignof(T)>::type storage;
+    T& value() { return *reinterpret_cast<T*>(&storage); }
+  };
+  using cell_traits = typename std::allocator_traits<Allocator>::template rebind_traits<cell>;
+  // producers and the owner each hammer their own position, keep them off each other's cache line.
+  // Padded rather than aligned so the signal holding the ring doesn't become over-aligned
+  struct position {
+    std::atomic<std::size_t> value;
+    char padding[64 - sizeof(std::atomic<std::size_t>)];
+  };
+  static_assert(std::is_nothrow_move_constructible<T>::value,
+                "values are built before a cell is claimed and moved in after, the move can't throw");
+public:
+  using size_type = std::size_t;
+  using allocator_type = typename cell_traits::allocator_type;
+
+  // iterates over values claimed by the owner, see claim()
+  class iterator {
+  public:
+    using iterator_category = std::forward_iterator_tag;
+    using value_type = T;
+    using difference_type = std::ptrdiff_t;
+    using pointer = T*;
+    using reference = T&;
+    iterator(cell* cells, size_type mask, size_type position) : m_cells(cells), m_mask(mask), m_position(position) {};
+    T& operator*() const { return m_cells[m_position & m_mask].value(); }
+    T* operator->() const { return &**this; }
+    iterator& operator++() { ++m_position; return *this; }
+    iterator operator++(int) { auto it = *this; ++m_position; return it; }
+    bool operator==(const iterator& other) const { return m_position == other.m_position; }
+    bool operator!=(const iterator& other) const { return m_position != other.m_position; }
+  private:
+    cell* m_cells;
+    size_type m_mask;
+    size_type m_position;
+  };
+
+  // capacity is rounded up to a power of two
+  explicit mailbox_ring(size_type capacity, const allocator_type& alloc = allocator_type())
+  : m_allocator(alloc), m_capacity(round_up(capacity)), m_cells(cell_traits::allocate(m_allocator, m_capacity))
+  {
+    for (size_type i = 0; i != m_capacity; i++) {
+      ::new (&m_cells[i].sequence) std::atomic<std::size_t>(i);
+    }
+    m_tail.value.store(0, std::memory_order_relaxed);
+    m_head.value.store(0, std::memory_order_relaxed);
+  }
+  mailbox_ring(const mailbox_ring&) = delete;
+  mailbox_ring& operator=(const mailbox_ring&) = delete;
+  // only once every producer is gone
+  ~mailbox_ring() {
+    while (drop_oldest()) {}
+    for (size_type i = 0; i != m_capacity; i++) m_cells[i].sequence.~atomic();
+    cell_traits::deallocate(m_allocator, m_cells, m_capacity);
+  }
+
+  // false when the ring is full, value is left alone then
+  bool try_push(T& value)
+  {
+    auto pos = m_tail.value.load(std::memory_order_relaxed);
+    for (;;) {
+      auto& target = m_cells[pos & mask()];
+      auto turn = std::intptr_t(target.sequence.load(std::memory_order_acquire) - pos);
+      if (turn == 0) {
+        if (m_tail.value.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+          ::new (&target.storage) T(std::move(value));
+          target.sequence.store(pos + 1, std::memory_order_release);
+          return true;
+        }
+      } else if (turn < 0) {
+        // the cell still holds the value from a lap ago
+        return false;
+      } else {
+        pos = m_tail.value.load(std::memory_order_relaxed);
+      }
+    }
+  }
+
+  // destroys the oldest published value, false if there's nothing the owner hasn't already claimed
+  bool drop_oldest()
+  {
+    auto pos = m_head.value.load(std::memory_order_relaxed);
+    for (;;) {
+      auto& target = m_cells[pos & mask()];
+      auto turn = std::intptr_t(target.sequence.load(std::memory_order_acquire) - (pos + 1));
+      if (turn == 0) {
+        if (m_head.value.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+          release(pos);
+          return true;
+        }
+      } else if (turn < 0) {
+        return false;
+      } else {
+        pos = m_head.value.load(std::memory_order_relaxed);
+      }
+    }
+  }
+
+  // owner side: claims up to max published values, oldest first. They stay in their cells, and
+  // producers can't reuse those cells, until release(first, count). Returns how many were claimed
+  size_type claim(size_type max, size_type& first)
+  {
+    auto pos = m_head.value.load(std::memory_order_relaxed);
+    for (;;) {
+      size_type count = 0;
+      while (count < max && count < m_capacity &&
+             m_cells[(pos + count) & mask()].sequence.load(std::memory_order_acquire) == pos + count + 1) {
+        count++;
+      }
+      if (count == 0) {
+        // a producer dropping the oldest value may have moved the head under us
+        auto head = m_head.value.load(std::memory_order_relaxed);
+        if (head == pos) return 0;
+        pos = head;
+        continue;
+      }
+      if (m_head.value.compare_exchange_weak(pos, pos + count, std::memory_order_relaxed)) {
+        first = pos;
+        return count;
+      }
+    }
+  }
+  void release(size_type first, size_type count)
+  {
+    for (auto pos = first; pos != first + count; pos++) release(pos);
+  }
+  iterator at(size_type position) { return { m_cells, mask(), position }; }
+
+  size_type capacity() const { return m_capacity; }
+  // published and in-flight values, only a snapshot while producers are running
+  size_type size() const {
+    // the head never passes the tail, so reading it first can't make the difference negative
+    auto head = m_head.value.load(std::memory_order_acquire);
+    auto tail = m_tail.value.load(std::memory_order_acquire);
+    return tail - head;
+  }
+private:
+  static size_type round_up(size_type capacity)
+  {
+    size_type size = 2;
+    while (size < capacity) size *= 2;
+    return size;
+  }
+  size_type mask() const { return m_capacity - 1; }
+  void release(size_type pos)
+  {
+    auto& target = m_cells[pos & mask()];
+    target.value().~T();
+    target.sequence.store(pos + m_capacity, std::memory_order_release);
+  }
+
+  allocator_type m_allocator;
+  size_type m_capacity;
+  cell* m_cells;
+  position m_tail;
+  position m_head;
+};
+
+}
+}
+
+#endif
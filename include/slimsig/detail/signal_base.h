@@ -20,17 +20,115 @@
 #include <cassert>
 
 #include "../connection.h"
+#include "inplace_function.h"
+#include "slot_storage.h"
+#include "slot_call_iterator.h"
+#include "../thread_pool.h"
+#include "instrumentation.h"
+#include "../combiners.h"
 
 namespace slimsig {
 
+// signals are not thread safe unless their signal_traits ask for it
+struct single_threaded {};
+// lock-free emit from any thread, see concurrent_signal_base
+struct concurrent {
+  // reader counters are spread over this many cache lines
+  static constexpr std::size_t reader_stripes = 8;
+};
+
+// how emit_batch walks the slots and the events
+enum class batch_order {
+  // every slot for the first event, then every slot for the next, same as calling emit in a loop
+  event_major,
+  // every event for the first slot, then every event for the next
+  // keeps each slot's code and captures hot, but slots see the events interleaved differently
+  slot_major
+};
+
+// Compaction policies decide what happens to disconnected slots once the outermost emit finishes.
+// budget(live, stored) gets the number of connected slots and the number of slots taking up
+// space (connected or not) and returns how many slots to examine: 0 leaves everything for later,
+// anything >= stored compacts the whole list and anything else takes one incremental step.
+// Until they're compacted away, disconnected slots are skipped by emit.
+
+// compact after every emit that leaves a disconnected slot behind
+struct compact_always {
+  static std::size_t budget(std::size_t live, std::size_t stored) {
+    return live == stored ? 0 : stored;
+  }
+};
+
+// compact once at least Percent% of the stored slots are disconnected
+// each slot is then moved O(100 / Percent) times over its lifetime however often it's disconnected
+template <unsigned Percent>
+struct compact_ratio {
+  static_assert(Percent > 0 && Percent <= 100, "compact_ratio takes a percentage");
+  static std::size_t budget(std::size_t live, std::size_t stored) {
+    return (stored - live) * 100 >= stored * Percent && live != stored ? stored : 0;
+  }
+};
+
+// examine at most Budget slots after each emit, so no single emit pays for a full pass
+template <std::size_t Budget>
+struct compact_incremental {
+  static_assert(Budget > 0, "compact_incremental needs a budget");
+  static std::size_t budget(std::size_t live, std::size_t stored) {
+    return live == stored ? 0 : Budget;
+  }
+};
+
+// Shrink policies decide when the slot list gives back capacity it doesn't need. capacity(stored,
+// capacity) gets the number of slots taking up space and the current capacity and returns the
+// capacity to shrink to, anything >= capacity keeps it. They're asked after a compaction and by
+// disconnect_all, never while the signal is emitting.
+
+// keep whatever capacity the slot list has grown to
+struct shrink_never {
+  static std::size_t capacity(std::size_t, std::size_t capacity) {
+    return capacity;
+  }
+};
+
+// once fewer than capacity / Divisor slots are stored, shrink to twice the stored slots (but not
+// below Minimum). A list has to lose half its slots again before it shrinks a second time, and has
+// to double before it grows, so a signal hovering around one size doesn't keep reallocating
+template <std::size_t Divisor = 4, std::size_t Minimum = 0>
+struct shrink_below {
+  static_assert(Divisor > 2, "shrinking to twice the stored slots needs a divisor above 2");
+  static std::size_t capacity(std::size_t stored, std::size_t capacity) {
+    return stored * Divisor < capacity && capacity > Minimum ? std::max(stored * 2, Minimum) : capacity;
+  }
+};
+
 template <class Handler>
 struct signal_traits;
 
 template <class R, class... Args>
 struct signal_traits<R(Args...)> {
   using return_type = R;
+  // combines slot results into the value returned by emit
+  using combiner_type = last_value<R>;
   using slot_id_type = std::size_t;
   using depth_type = unsigned;
+  // bytes of inline storage each slot reserves for its callable
+  // anything larger is heap allocated (the default fits three pointers, same footprint as std::function)
+  static constexpr std::size_t slot_storage_size = 3 * sizeof(void*);
+  // how slots are laid out in memory, see slot_layout
+  static constexpr slot_layout layout = slot_layout::interleaved;
+  using thread_policy = single_threaded;
+  // when disconnected slots are removed from the slot list, see compact_always
+  // ignored by concurrent signals, which copy the slot list on every change anyway
+  using compaction_policy = compact_always;
+  // when the slot list gives back capacity, see shrink_below
+  // ignored by concurrent signals, whose snapshots are never bigger than they need to be
+  using shrink_policy = shrink_never;
+  // slots stored inside the signal object before the slot list moves to the heap, see small_signal
+  // only the interleaved layout of single threaded signals supports inline slots
+  static constexpr std::size_t inline_slots = 0;
+  // keep emit/compaction counters and register the signal with signal_registry
+  // costs a few relaxed atomic increments per emit, compiled out entirely when false
+  static constexpr bool instrumented = false;
 };
 
 template <class Handler, class SignalTraits, class Allocator>
@@ -55,32 +153,64 @@ namespace detail {
   {
     return each<Container, Callback>(container, begin, begin + count, fn);
   }
+  // calls one slot with the elements of an event tuple from emit_batch
+  template <class SlotList>
+  struct batch_invoker {
+    const SlotList& slots;
+    typename SlotList::size_type index;
+    template <class... T>
+    [[gnu::always_inline]]
+    inline void operator()(T&&... args) const { slots.invoke(index, std::forward<T>(args)...); }
+  };
 }
 template<class SignalTraits, class Allocator, class R, class... Args>
 class signal_base<SignalTraits, Allocator, R(Args...)>
 {
   struct emit_scope;
+  struct parallel_state;
 public:
   using signal_traits = SignalTraits;
   using return_type = typename signal_traits::return_type;
-  using callback = std::function<R(Args...)>;
+  using combiner_type = typename signal_traits::combiner_type;
+  using result_type = typename combiner_type::result_type;
   using allocator_type = Allocator;
-  using slot = basic_slot<R(Args...), typename signal_traits::slot_id_type>;
+  using slot = basic_slot<R(Args...), typename signal_traits::slot_id_type,
+                          detail::inplace_function<R(Args...), signal_traits::slot_storage_size>>;
+  using callback = typename slot::callback;
   using list_allocator_type = typename std::allocator_traits<Allocator>::template rebind_traits<slot>::allocator_type;
-  using slot_list = std::vector<slot, list_allocator_type>;
+  using slot_id = typename signal_traits::slot_id_type;
+  using compaction_policy = typename signal_traits::compaction_policy;
+  using shrink_policy = typename signal_traits::shrink_policy;
+  using slot_list = typename std::conditional<signal_traits::layout == slot_layout::split,
+                                              detail::slot_columns<callback, slot_id, allocator_type>,
+                                              detail::slot_vector<slot, signal_traits::inline_slots, allocator_type>>::type;
+  static_assert(signal_traits::inline_slots == 0 || signal_traits::layout == slot_layout::interleaved,
+                "inline slots need slot_layout::interleaved");
   
   using connection = slimsig::connection<signal_base>;
+  using signal_type = slimsig::signal<R(Args...), SignalTraits, Allocator>;
   using extended_callback = std::function<R(connection& conn, Args...)>;
-  using slot_id = typename signal_traits::slot_id_type;
-  using slot_reference = typename slot_list::reference;
-  using const_slot_reference = typename slot_list::const_reference;
+  using slot_reference = slot&;
+  using const_slot_reference = const slot&;
   using size_type = std::size_t;
+  // what combiners and emit_batch call slots through, once slots are disconnected as they're called
+  class slot_calls {
+  public:
+    using size_type = std::size_t;
+    slot_calls(signal_base& s) : m_signal(s) {};
+    size_type size() const { return m_signal.pending.size(); }
+    bool connected(size_type index) const { return m_signal.pending.connected(index); }
+    template <class... T>
+    [[gnu::always_inline]]
+    inline R invoke(size_type index, T&&... args) const {
+      return m_signal.call(index, std::forward<T>(args)...);
+    }
+  private:
+    signal_base& m_signal;
+  };
+  using slot_call_iterator = detail::slot_call_iterator<slot_calls, R, Args...>;
 public:
   static constexpr auto arity = sizeof...(Args);
-  struct signal_holder {
-    signal_holder(signal_base* p) : signal(p) {};
-    signal_base* signal;
-  };
   template <std::size_t N>
   struct argument
   {
@@ -91,19 +221,20 @@ public:
   // allocator constructor
   signal_base(const allocator_type& alloc) :
     pending(alloc),
-    m_self(nullptr),
     last_id(),
     m_size(0),
     m_offset(0),
     allocator(alloc),
-    m_depth(0){};
+    m_depth(0),
+    m_parallel(nullptr),
+    m_stats(this){};
   
   signal_base(size_t capacity, const allocator_type& alloc = allocator_type{})
   : signal_base(alloc) {
     pending.reserve(capacity);
   };
   
-  signal_base(signal_base&& other) {
+  signal_base(signal_base&& other) : signal_base(other.get_allocator()) {
     this->swap(other);
   }
   signal_base& operator=(signal_base&& other) {
@@ -124,56 +255,145 @@ public:
         throw new std::logic_error("Signals can not be swapped or moved while emitting");
     #endif
       swap(pending, rhs.pending);
-      swap(m_self, rhs.m_self);
-      if (m_self) m_self->signal = this;
-      if (rhs.m_self) rhs.m_self->signal = &rhs;
       swap(last_id, rhs.last_id);
       swap(m_size, rhs.m_size);
       swap(m_offset, rhs.m_offset);
-      if (std::allocator_traits<allocator_type>::propagate_on_container_swap::value)
-        swap(allocator, rhs.allocator);
+      // connections find their signal through the handle table
+      adopt_handles();
+      rhs.adopt_handles();
+      detail::swap_allocators(allocator, rhs.allocator);
       swap(m_depth, rhs.m_depth);
     }
   }
 
-  return_type emit(Args... args) {
-    using detail::each;
-    // scope guard
-    emit_scope scope { *this };
-
-    auto end = pending.size();
-    assert(m_offset <= end);
-    if (end - m_offset == 0) return;
-    assert(end > 0);
-    each(pending, m_offset, --end, [&] (const_slot_reference slot) {
-      if (slot) slot(args...);
-    });
-    auto& slot = pending[end];
-    if (slot)  slot(std::forward<Args&&>(args)...);
+  result_type emit(Args... args) {
+    return emit_impl(std::is_same<combiner_type, last_value<void>>{}, args...);
   }
-  return_type operator()(Args... args) {
+  result_type operator()(Args... args) {
     return emit(std::forward<Args&&>(args)...);
   }
   
-  inline connection connect(callback slot)
+  // emit, combining the slot results with the given combiner instead of the one from signal_traits
+  template <class Combiner>
+  typename std::decay<Combiner>::type::result_type emit_with(Combiner&& combiner, Args... args) {
+    return combine(combiner, args...);
+  }
+  
+  // emits once per std::tuple<Args...> in [first, last), with a single emit scope for the whole batch
+  // slot results are discarded. With batch_order::slot_major, slots connected during the batch don't
+  // see any of it, and disconnecting a slot (or disconnect_all) stops it from seeing the rest of the batch
+  template <class Iterator>
+  void emit_batch(Iterator first, Iterator last, batch_order order = batch_order::event_major) {
+    if (first == last) return;
+    emit_scope scope { *this };
+    slot_calls slots { *this };
+    if (order == batch_order::event_major) {
+      for (; first != last; ++first) {
+        auto& event = *first;
+        pending.for_each_connected(m_offset, pending.size(), [&] (size_type index) {
+          detail::apply_lvalues(detail::batch_invoker<slot_calls> { slots, index }, event);
+          scope.calls++;
+        });
+      }
+    } else {
+      for (size_type index = m_offset, end = pending.size(); index < end; index++) {
+        for (auto event = first; event != last && index >= m_offset && pending.connected(index); ++event) {
+          detail::apply_lvalues(detail::batch_invoker<slot_calls> { slots, index }, *event);
+          scope.calls++;
+        }
+      }
+    }
+  }
+  
+  // calls the slots on the shared work_stealing_pool, the calling thread helps and this returns once
+  // every slot has finished. Slot results are discarded and slots run in no particular order.
+  // Slots may connect and disconnect (including disconnect_all) while this runs: new slots are
+  // added once every slot has finished and disconnected slots are skipped if they haven't started.
+  // Slots must not emit this signal themselves
+  void emit_parallel(Args... args) {
+    emit_parallel_on(work_stealing_pool::shared(), args...);
+  }
+  void emit_parallel_on(work_stealing_pool& pool, Args... args) {
+    emit_scope scope { *this };
+    auto begin = m_offset, end = pending.size();
+    if (begin == end) return;
+    parallel_scope parallel { *this, begin, end };
+    auto& state = parallel.state;
+    // a few chunks per thread so stealing can even out slots that take longer than others
+    auto chunks = std::min<size_type>(end - begin, (pool.size() + 1) * 4);
+    auto chunk_size = (end - begin + chunks - 1) / chunks;
+    pool.parallel_for(chunks, [&] (std::size_t chunk) {
+      detail::emit_trace trace { this, m_depth };
+      std::uint64_t calls = 0;
+      for (auto index = begin + chunk * chunk_size, last = std::min(end, index + chunk_size); index < last; index++) {
+        // slots on other threads may disconnect a once slot between the check and its claim
+        if (!state.skipped(index) && pending.connected(index) && (pending.kind(index) != detail::slot_kind::once || claim(index))) {
+          pending.invoke(index, args...);
+          calls++;
+        }
+      }
+      m_stats.on_calls(calls);
+    });
+  }
+  
+  template <class F, class = typename std::enable_if<std::is_constructible<callback, F&&>::value>::type>
+  inline connection connect(F&& slot)
   {
+    auto guard = parallel_lock();
     auto sid = prepare_connection();
-    emplace(sid, std::move(slot));
-    return { m_self, sid };
+    return emplace(sid, acquire_handle(), detail::slot_kind::plain, std::forward<F>(slot));
   };
 
-  inline connection connect_extended(extended_callback slot)
+  // the slot gets its own connection as the first argument, any callable taking (connection&, Args...)
+  // works, extended_callback included, and it's stored directly rather than through std::function
+  template <class F>
+  inline connection connect_extended(F&& slot)
   {
+    using function_type = typename std::decay<F>::type;
     struct extended_slot {
-      callback fn;
+      function_type fn;
       connection conn;
       R operator()(Args&&... args) {
         return fn(conn, std::forward<Args>(args)...);
       }
     };
-    return create_connection<extended_slot>(std::move(slot));
+    return create_connection<extended_slot>(function_type(std::forward<F>(slot)));
   }
   
+  // calls (object->*method)(args...), the pair is kept in the slot itself and needs no allocation
+  // the object has to outlive the connection, see connect_weak
+  template <class T, class Class, class Method,
+            class = typename std::enable_if<std::is_member_function_pointer<Method Class::*>::value>::type>
+  inline connection connect(T* object, Method Class::* method)
+  {
+    return connect(detail::member_slot<T, Method Class::*> { object, method });
+  }
+
+  // like connect(object.get(), method) except the slot only holds a weak_ptr to the object
+  // and disconnects itself the first time it's called after the object is gone
+  template <class T, class Class, class Method,
+            class = typename std::enable_if<std::is_member_function_pointer<Method Class::*>::value>::type>
+  inline connection connect_weak(const std::shared_ptr<T>& object, Method Class::* method)
+  {
+    using target_type = detail::weak_member_slot<T, Method Class::*>;
+    struct weak_slot {
+      target_type target;
+      connection conn;
+      R operator()(Args&&... args) {
+        auto strong = target.object.lock();
+        if (strong) return static_cast<R>((strong.get()->*target.method)(std::forward<Args>(args)...));
+        conn.disconnect();
+        return detail::default_value<R>();
+      }
+    };
+    return create_connection<weak_slot>(target_type { object, method });
+  }
+
+  // re-emits target, which is held weakly, whenever this signal emits. The emit loop of a void
+  // signal walks into target's slots itself (see emit_relayed) instead of calling target.emit()
+  inline connection connect(std::shared_ptr<signal_type> target) {
+    return create_connection<relay_slot>(std::weak_ptr<signal_type>(target), detail::slot_kind::relay);
+  }
   template <class TP, class Alloc>
   inline connection connect(std::shared_ptr<signal<R(Args...), TP, Alloc>> signal) {
     using signal_type = slimsig::signal<R(Args...), TP, Alloc>;
@@ -186,43 +406,40 @@ public:
           return signal->emit(std::forward<Args>(args)...);
         } else {
           conn.disconnect();
-          return;
+          return detail::default_value<R>();
         }
       }
     };
     return create_connection<signal_slot>(std::move(signal));
   }
   
-  connection connect_once(callback slot)  {
-    struct fire_once {
-      callback fn;
-      connection conn;
-      R operator() (Args&&... args) {
-        auto scoped_connection = make_scoped_connection(std::move(conn));
-        return fn(std::forward<Args>(args)...);
-      }
-    };
-    return create_connection<fire_once>(std::move(slot));
+  // the slot is stored like any other and flagged, emit disconnects it right before calling it
+  template <class F, class = typename std::enable_if<std::is_constructible<callback, F&&>::value>::type>
+  connection connect_once(F&& slot)  {
+    auto guard = parallel_lock();
+    auto sid = prepare_connection();
+    return emplace(sid, acquire_handle(), detail::slot_kind::once, std::forward<F>(slot));
   }
   
 
   void disconnect_all() {
-    using std::for_each;
+    auto guard = parallel_lock();
+    if (m_parallel) {
+      disconnect_all_parallel();
+      return;
+    }
+    release_handles();
     if (is_running()) {
       m_offset = pending.size();
       m_size = 0;
     } else {
       pending.clear();
       m_size = 0;
-    }
-    // if we've used up a lot of id's we can take advantage of the fact that
-    // all connections are based on the current signal_holder pointer
-    // and reset our last_id to 0 without causing trouble with old connections
-    if (m_self && last_id > std::numeric_limits<slot_id>::max() / 3) {
-      m_self->signal = nullptr;
-      m_self.reset();
+      // connections don't refer to slot ids so we're free to start over
       last_id = slot_id();
+      shrink();
     }
+    sample_stats();
   }
   
   const allocator_type& get_allocator() const {
@@ -240,6 +457,10 @@ public:
   inline size_type remaining_slots() const {
     return max_size() - last_id;
   }
+  // bytes this signal takes up: itself, its slot list and callables too big to store inline
+  size_type memory_usage() const {
+    return sizeof(signal_type) + pending.memory_usage();
+  }
 
   size_type max_depth() const {
     return std::numeric_limits<unsigned>::max();
@@ -250,19 +471,89 @@ public:
   bool is_running() const {
     return m_depth > 0;
   }
+  
+  // counters for this signal, all zero unless signal_traits::instrumented is set
+  signal_stats stats() const {
+    return m_stats.snapshot();
+  }
+  // name reported in stats() and by signal_registry, ignored when the signal isn't instrumented
+  void set_name(std::string name) {
+    m_stats.set_name(std::move(name));
+  }
 
   ~signal_base() {
-    if (m_self) m_self->signal = nullptr;
+    release_handles();
   }
   template <class FN, class TP, class Alloc>
   friend class signal;
   template <class Signal>
   friend class slimsig::connection;
+  friend class slimsig::connection_set;
 private:
+  // called by combiners and the other emit paths, emit_relayed doesn't call it at all
+  struct relay_slot {
+    std::weak_ptr<signal_type> target;
+    connection conn;
+    R operator()(Args&&... args) {
+      auto signal = target.lock();
+      if (signal) return signal->emit(std::forward<Args>(args)...);
+      conn.disconnect();
+      return detail::default_value<R>();
+    }
+  };
+
+  // void signals with the default combiner don't need to look at results
+  [[gnu::always_inline]]
+  inline void emit_impl(std::true_type, Args&... args) {
+    if (pending.has_slots(detail::slot_kind::relay)) return emit_relayed(args...);
+    // scope guard
+    emit_scope scope { *this };
+
+    auto end = pending.size();
+    assert(m_offset <= end);
+    if (end - m_offset == 0) return;
+    assert(end > 0);
+    pending.for_each_connected(m_offset, --end, [&] (size_type index) {
+      call(index, args...);
+      scope.calls++;
+    });
+    if (pending.connected(end)) {
+      scope.calls++;
+      call(end, std::forward<Args>(args)...);
+    }
+  }
+  [[gnu::always_inline]]
+  inline result_type emit_impl(std::false_type, Args&... args) {
+    combiner_type combiner;
+    return combine(combiner, args...);
+  }
+  
+  template <class Combiner>
+  typename Combiner::result_type combine(Combiner& combiner, Args&... args) {
+    using state_type = detail::slot_call_state<slot_calls, R, Args...>;
+    emit_scope scope { *this };
+    auto end = pending.size();
+    assert(m_offset <= end);
+    slot_calls slots { *this };
+    state_type state { slots, args... };
+    struct count_calls {
+      emit_scope& scope;
+      state_type& state;
+      ~count_calls() { scope.calls += state.calls; }
+    } counter { scope, state };
+    return combiner(slot_call_iterator { state, m_offset, end }, slot_call_iterator { state, end, end });
+  }
+  
   struct emit_scope{
     signal_base& signal;
-    emit_scope(signal_base& context) : signal(context) {
+    // slots called by this emit, only used when the signal is instrumented
+    std::uint64_t calls;
+    // declared last so the traced span covers compaction too
+    detail::emit_trace trace;
+    emit_scope(signal_base& context) : signal(context), calls(0), trace(&context, context.m_depth + 1) {
+      assert(signal.m_parallel == nullptr && "slots can't emit a signal that is running emit_parallel");
       signal.m_depth++;
+      signal.m_stats.on_emit(signal.m_depth);
     }
     emit_scope() = delete;
     emit_scope(const emit_scope&) = delete;
@@ -271,89 +562,344 @@ private:
       using std::move;
       using std::for_each;
       using std::remove_if;
+      signal.m_stats.on_calls(calls);
       auto depth = --signal.m_depth;
       // if we completed iteration (depth = 0) collapse all the levels into the head list
       if (depth == 0) {
         auto m_size = signal.m_size;
         auto& pending = signal.pending;
+        pending.release_retired();
         // if the size is different than the expected size
         // we have some slots we need to remove
         if (m_size != pending.size()) {
-          // remove slots from disconnect_all
-          pending.erase(pending.begin(), pending.begin() + signal.m_offset);
-          pending.erase(remove_if(pending.begin(), pending.end(), &is_disconnected), pending.end());
+          // slots before the offset were dropped by disconnect_all, those always go right away
+          auto budget = signal.m_offset ? pending.size() : compaction_policy::budget(m_size, pending.size());
+          if (budget >= pending.size()) {
+            auto timer = signal.m_stats.time_compaction();
+            pending.compact(signal.m_offset);
+            signal.relocate_handles();
+          } else if (budget > 0) {
+            auto timer = signal.m_stats.time_compaction();
+            auto& table = detail::handle_table::instance();
+            pending.compact_some(budget, [&] (size_type index) {
+              table.relocate(pending.handle(index), index);
+            });
+          }
+          signal.shrink();
         }
         signal.m_offset = 0;
-        assert(m_size == pending.size());
+        assert(m_size <= pending.size());
+        signal.sample_stats();
       }
     }
   };
 
-  static bool is_disconnected(const_slot_reference slot) {  return !bool(slot); };
-  
-  inline bool connected(slot_id index)
-  {
-    using std::lower_bound;
-    auto end = pending.cend();
-    auto slot = lower_bound(pending.cbegin() + m_offset, end, index, [] (const_slot_reference slot, const slot_id& idx) {
-      return slot < idx;
-    });
-    if (slot != end && slot->m_slot_id == index) return slot->connected();
-    return false;
+  // relays this many signals deep are walked without recursing, deeper ones emit the usual way
+  static constexpr std::size_t relay_depth = 8;
+  // the signals emit_relayed is in the middle of, each with its own emit scope. Scopes are ended
+  // newest first, also when a slot throws
+  class relay_walk {
+  public:
+    struct frame {
+      frame(signal_base& s, std::shared_ptr<signal_type> o)
+      : signal(&s), owner(std::move(o)), scope(s), index(s.m_offset), end(s.pending.size()) {};
+      signal_base* signal;
+      // keeps a relayed signal alive even if one of its own slots lets go of it
+      std::shared_ptr<signal_type> owner;
+      emit_scope scope;
+      size_type index;
+      size_type end;
+    };
+    relay_walk() = default;
+    relay_walk(const relay_walk&) = delete;
+    ~relay_walk() {
+      while (m_size) pop();
+    }
+    void push(signal_base& signal, std::shared_ptr<signal_type> owner) {
+      ::new (&m_frames[m_size]) frame(signal, std::move(owner));
+      m_size++;
+    }
+    void pop() {
+      top().~frame();
+      m_size--;
+    }
+    frame& top() { return *reinterpret_cast<frame*>(&m_frames[m_size - 1]); }
+    std::size_t size() const { return m_size; }
+  private:
+    // frames are only constructed as the walk reaches them
+    typename std::aligned_storage<sizeof(frame), alignof(frame)>::type m_frames[relay_depth];
+    std::size_t m_size = 0;
   };
   
-  inline void disconnect(slot_id index)
-  {
-    using std::lower_bound;
-    auto end = pending.end();
-    auto slot = lower_bound(pending.begin() + m_offset, end, index, [] (slot_reference slot, const slot_id& idx) {
-      return slot < idx;
-    });
-    if (slot != end && slot->m_slot_id == index) {
-      if (slot->connected()) {
-       slot->disconnect();
-       m_size -= 1;
+  // emit for signals with relay slots: a depth first walk over this signal and every signal it
+  // relays to, in the order nested emits would have called them, with one weak_ptr lock per hop
+  // and no recursion. Relayed signals get an emit scope each so their slots can connect and
+  // disconnect as usual. Every slot gets the arguments as lvalues
+  void emit_relayed(Args&... args) {
+    relay_walk walk;
+    walk.push(*this, nullptr);
+    while (walk.size()) {
+      auto& frame = walk.top();
+      auto& signal = *frame.signal;
+      auto& slots = signal.pending;
+      auto end = frame.end;
+      auto index = slots.next_connected(frame.index, end);
+      for (; index != end; index = slots.next_connected(index + 1, end)) {
+        frame.scope.calls++;
+        if (slots.kind(index) == detail::slot_kind::relay && walk.size() < relay_depth) {
+          // relays that didn't fit inline storage, and expired ones, are called like any other slot
+          auto relay = slots.callable(index).template target<relay_slot>();
+          auto target = relay ? relay->target.lock() : nullptr;
+          if (target) {
+            frame.index = index + 1;
+            auto& next = static_cast<signal_base&>(*target);
+            walk.push(next, std::move(target));
+            break;
+          }
+        }
+        signal.call(index, args...);
       }
-      
+      if (index == end) walk.pop();
     }
+  }
+
+  // only called by connections whose handle is still alive, so the handle table
+  // already tells us exactly where the slot is
+  inline void disconnect(const detail::slot_handle& handle)
+  {
+    auto guard = parallel_lock();
+    auto& table = detail::handle_table::instance();
+    auto index = table.position(handle);
+    if (m_parallel) {
+      // slots on other threads may have disconnected it since the connection looked us up
+      if (!table.alive(handle)) return;
+      m_parallel->disconnect(index, pending.size());
+    } else {
+      assert(index < pending.size() && pending.handle(index) == handle.index);
+      pending.disconnect(index, is_running());
+    }
+    table.release(handle.index);
+    m_size -= 1;
+    if (!m_parallel) sample_stats();
   };
   
+  // disconnects every handle in [first, last) that is still connected, *first converts to a slot_handle.
+  // Positions come straight from the handle table, so there's nothing to search or sort
+  template <class Iterator>
+  void disconnect(Iterator first, Iterator last)
+  {
+    auto guard = parallel_lock();
+    auto& table = detail::handle_table::instance();
+    auto running = is_running();
+    size_type count = 0;
+    for (; first != last; ++first) {
+      const detail::slot_handle& handle = *first;
+      if (!table.alive(handle)) continue;
+      if (m_parallel) m_parallel->disconnect(table.position(handle), pending.size());
+      else pending.disconnect(table.position(handle), running);
+      table.release(handle.index);
+      count++;
+    }
+    m_size -= count;
+    if (!m_parallel) sample_stats();
+  }
+
+  // calls a connected slot, once slots are disconnected first so nothing they do can call them again.
+  // The callable survives that until the outermost emit finishes, see slot_vector::disconnect
+  template <class... T>
+  [[gnu::always_inline]]
+  inline R call(size_type index, T&&... args)
+  {
+    if (pending.has_slots(detail::slot_kind::once) && pending.kind(index) == detail::slot_kind::once) claim(index);
+    return pending.invoke(index, std::forward<T>(args)...);
+  }
+  // disconnects a once slot the emit loop is about to call, false if a slot on another thread
+  // beat emit_parallel to it
+  bool claim(size_type index)
+  {
+    auto guard = parallel_lock();
+    if (m_parallel) {
+      if (m_parallel->skipped(index)) return false;
+      m_parallel->disconnect(index, pending.size());
+    } else if (index < m_offset) {
+      // disconnect_all already dropped it along with its handle, the running emit still calls it
+      return true;
+    } else {
+      assert(pending.connected(index));
+      pending.disconnect(index, true);
+    }
+    detail::handle_table::instance().release(pending.handle(index));
+    m_size -= 1;
+    if (!m_parallel) sample_stats();
+    return true;
+  }
+
   template<class C, class T>
   [[gnu::always_inline]]
-  inline connection create_connection(T&& slot)
+  inline connection create_connection(T&& slot, detail::slot_kind kind = detail::slot_kind::plain)
   {
+    auto guard = parallel_lock();
     auto sid = prepare_connection();
-    emplace(sid, C { std::move(slot), {m_self, sid} });
-    return connection { m_self, sid };
+    auto handle = acquire_handle();
+    return emplace(sid, handle, kind, C { std::move(slot), connection { handle } });
   }
   
   [[gnu::always_inline]]
   inline slot_id prepare_connection()
   {
-    // lazy initialize to put off heap allocations if the user
-    // has not connected a slot
-    if (!m_self) m_self = std::make_shared<signal_holder>(this);
     assert((last_id < std::numeric_limits<slot_id>::max() - 1) && "All available slot ids for this signal have been exhausted. This may be a sign you are misusing signals");
     return last_id++;
   }
   
+  // the slot we're about to add will end up at the back
+  [[gnu::always_inline]]
+  inline detail::slot_handle acquire_handle()
+  {
+    auto position = pending.size() + (m_parallel ? m_parallel->connects.size() : 0);
+    return detail::handle_table::instance().acquire(static_cast<void*>(this), position);
+  }
+  
   template <class... SlotArgs>
   [[gnu::always_inline]]
-  inline void emplace(SlotArgs&&... args)
+  inline connection emplace(slot_id sid, detail::slot_handle handle, detail::slot_kind kind, SlotArgs&&... args)
   {
-    pending.emplace_back(std::forward<SlotArgs>(args)...);
+    // callables too big for the slot's inline storage are allocated with the signal's allocator
+    if (m_parallel) return m_parallel->connect(*this, sid, handle, kind, callback(std::allocator_arg, allocator, std::forward<SlotArgs>(args)...));
+    pending.emplace_back(is_running(), sid, handle.index, kind, std::allocator_arg, allocator, std::forward<SlotArgs>(args)...);
+    if (!pending.connected(pending.size() - 1)) {
+      // empty callables never connect
+      detail::handle_table::instance().release(handle.index);
+      return {};
+    }
     m_size++;
+    sample_stats();
+    return { handle };
+  }
+  
+  // gives back the handles of every connected slot, invalidating their connections
+  void release_handles()
+  {
+    auto& table = detail::handle_table::instance();
+    pending.for_each_connected(m_offset, pending.size(), [&] (size_type index) {
+      table.release(pending.handle(index));
+    });
+  }
+  // after compaction every slot may have moved
+  void relocate_handles()
+  {
+    auto& table = detail::handle_table::instance();
+    for (size_type index = 0, end = pending.size(); index != end; index++) {
+      table.relocate(pending.handle(index), index);
+    }
+  }
+  void disconnect_all_parallel()
+  {
+    auto& table = detail::handle_table::instance();
+    auto& state = *m_parallel;
+    pending.for_each_connected(state.begin, state.end, [&] (size_type index) {
+      if (!state.skipped(index)) {
+        state.disconnect(index, pending.size());
+        table.release(pending.handle(index));
+      }
+    });
+    for (auto& deferred : state.connects) {
+      if (deferred.fn) {
+        table.release(deferred.handle);
+        deferred.fn = nullptr;
+      }
+    }
+    m_size = 0;
+  }
+  // connect/disconnect lock while emit_parallel is running since slots call them from any thread
+  std::unique_lock<std::mutex> parallel_lock()
+  {
+    return m_parallel ? std::unique_lock<std::mutex>(m_parallel->lock) : std::unique_lock<std::mutex>();
+  }
+  
+  // changes made by slots during emit_parallel, applied once every slot has finished
+  struct parallel_state {
+    struct deferred_slot {
+      slot_id sid;
+      std::uint32_t handle;
+      detail::slot_kind kind;
+      callback fn;
+    };
+    parallel_state(size_type first, size_type last)
+    : begin(first), end(last), skip(new std::atomic<bool>[last - first]()), lock(), connects(), disconnects() {};
+    inline bool skipped(size_type index) const {
+      return skip[index - begin].load(std::memory_order_acquire);
+    }
+    // index is where the handle table says the slot is, past the end of the list means it hasn't been added yet
+    void disconnect(size_type index, size_type size) {
+      if (index >= size) {
+        connects[index - size].fn = nullptr;
+      } else {
+        skip[index - begin].store(true, std::memory_order_release);
+        disconnects.push_back(index);
+      }
+    }
+    connection connect(signal_base& signal, slot_id sid, detail::slot_handle handle, detail::slot_kind kind, callback fn) {
+      if (!fn) {
+        detail::handle_table::instance().release(handle.index);
+        return {};
+      }
+      connects.push_back({ sid, handle.index, kind, std::move(fn) });
+      signal.m_size++;
+      return { handle };
+    }
+    size_type begin;
+    size_type end;
+    std::unique_ptr<std::atomic<bool>[]> skip;
+    std::mutex lock;
+    std::vector<deferred_slot> connects;
+    std::vector<size_type> disconnects;
+  };
+  struct parallel_scope {
+    signal_base& signal;
+    parallel_state state;
+    parallel_scope(signal_base& context, size_type begin, size_type end) : signal(context), state(begin, end) {
+      signal.m_parallel = &state;
+    }
+    parallel_scope(const parallel_scope&) = delete;
+    ~parallel_scope() {
+      signal.m_parallel = nullptr;
+      for (auto index : state.disconnects) signal.pending.disconnect(index, true);
+      // cancelled slots are added empty so the handle positions we gave out stay right, compaction drops them
+      for (auto& deferred : state.connects) {
+        signal.pending.emplace_back(true, deferred.sid, deferred.handle, deferred.kind, std::move(deferred.fn));
+      }
+    }
+  };
+  
+  // slots don't move relative to each other, so handle positions stay right
+  void shrink()
+  {
+    auto capacity = pending.capacity();
+    auto target = shrink_policy::capacity(pending.size(), capacity);
+    if (target < capacity) pending.shrink_to(target);
+  }
+  [[gnu::always_inline]]
+  inline void sample_stats()
+  {
+    m_stats.sample(m_size, pending.size(), pending.capacity());
+  }
+  void adopt_handles()
+  {
+    auto& table = detail::handle_table::instance();
+    pending.for_each_connected(m_offset, pending.size(), [&] (size_type index) {
+      table.set_owner(pending.handle(index), static_cast<void*>(this));
+    });
   }
 protected:
-  std::vector<slot> pending;
+  slot_list pending;
 private:
-  std::shared_ptr<signal_holder> m_self;
   slot_id last_id;
   std::size_t m_size;
   std::size_t m_offset;
   allocator_type allocator;
   unsigned m_depth;
-  
+  parallel_state* m_parallel;
+  detail::signal_counters<signal_traits::instrumented> m_stats;
 };
 
   template <class Handler, class ThreadPolicy, class Allocator>
@@ -12,7 +12,10 @@
 #include <vector>
 #include <iterator>
 #include <algorithm>
+#include <functional>
 #include <type_traits>
+#include <cstdint>
+#include <memory>
 
 namespace slimsig {
 namespace detail {
@@ -20,21 +23,48 @@ namespace detail {
 template <class T>
 [[gnu::always_inline]] inline T default_value() { return T(); }
 template<> [[gnu::always_inline]] inline void default_value<void>() {}
+
+// what the emit loop does with a slot besides calling it
+enum class slot_kind : std::uint8_t {
+  plain,
+  // disconnected right before it's called, see signal_base::connect_once
+  once,
+  // re-emits another signal, the emit loop walks into it rather than calling it
+  relay
+};
+
+// an object and one of its member functions, small enough for a slot's inline storage
+template <class T, class Method>
+struct member_slot {
+  T* object;
+  Method method;
+  template <class... Args>
+  [[gnu::always_inline]]
+  inline auto operator()(Args&&... args) const -> decltype((object->*method)(std::forward<Args>(args)...)) {
+    return (object->*method)(std::forward<Args>(args)...);
+  }
+};
+// same but the object is only held weakly, see signal_base::connect_weak
+template <class T, class Method>
+struct weak_member_slot {
+  std::weak_ptr<T> object;
+  Method method;
+};
 }
 
-template <class Callback, class SlotID>
+template <class Callback, class SlotID, class Storage = std::function<Callback>>
 class basic_slot;
 
-template <class R, class... Args, class SlotID>
-class basic_slot<R(Args...), SlotID> {
+template <class R, class... Args, class SlotID, class Storage>
+class basic_slot<R(Args...), SlotID, Storage> {
 public:
-  using callback = std::function<R(Args...)>;
+  using callback = Storage;
   using slot_id = SlotID;
   
-  basic_slot(slot_id sid, callback fn) : m_fn(std::move(fn)), m_slot_id(sid), m_is_connected(bool(m_fn)), m_is_running(false) {}
+  basic_slot(slot_id sid, callback fn) : m_fn(std::move(fn)), m_slot_id(sid), m_is_connected(bool(m_fn)), m_running(0) {}
   basic_slot() : basic_slot(0, nullptr) {}
   template <class... Arguments>
-  basic_slot(slot_id sid, Arguments&&... args) : m_fn(std::forward<Arguments>(args)...), m_slot_id(sid), m_is_connected(bool(m_fn)), m_is_running(false) {}
+  basic_slot(slot_id sid, Arguments&&... args) : m_fn(std::forward<Arguments>(args)...), m_slot_id(sid), m_is_connected(bool(m_fn)), m_running(0) {}
   basic_slot(basic_slot&&) = default;
   basic_slot(const basic_slot&) = default;
   inline basic_slot& operator=(const basic_slot&) = default;
@@ -83,7 +113,7 @@ public:
   [[gnu::always_inline]]
   inline void disconnect() {
     m_is_connected = false;
-    if (!m_is_running) {
+    if (!m_running) {
       m_fn = nullptr;
     }
   }
@@ -101,15 +131,19 @@ public:
     struct invoke_guard
     {
       const basic_slot& slot;
-      ~invoke_guard() { slot.m_is_running = false;}
+      ~invoke_guard() { --slot.m_running; }
     } guard { *this };
-    m_is_running = true;
+    ++m_running;
     return m_fn(std::forward<Args>(args)...);
   }
   callback m_fn;
   slot_id m_slot_id;
+  // index of this slot's entry in the connection handle table
+  std::uint32_t m_handle = ~std::uint32_t(0);
   bool m_is_connected;
-  mutable bool m_is_running;
+  // how many calls to this slot are in progress, a slot that emits its own signal can re-enter itself
+  mutable unsigned m_running;
+  detail::slot_kind m_kind = detail::slot_kind::plain;
 };
 
 /**
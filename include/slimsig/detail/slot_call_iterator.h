@@ -9,11 +9,148 @@
 #ifndef slimsig_slot_call_iterator_h
 #define slimsig_slot_call_iterator_h
 #include <iterator>
+#include <tuple>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <limits>
+#include "apply.h"
+
 namespace slimsig { namespace detail {
-template <class Iterator>
-class slot_call_iterator : std::iterator<std::forward_iterator_tag> {
-  
-}
+
+// holds the result of the slot currently under the iterator
+// lives on the emitting stack frame so iterating never allocates
+template <class T>
+class slot_result_cache {
+public:
+  slot_result_cache() : m_has_value(false) {};
+  slot_result_cache(const slot_result_cache&) = delete;
+  slot_result_cache& operator=(const slot_result_cache&) = delete;
+  ~slot_result_cache() { reset(); }
+  template <class F>
+  void emplace(F&& fn) {
+    reset();
+    ::new (&m_storage) T(fn());
+    m_has_value = true;
+  }
+  void reset() {
+    if (m_has_value) {
+      get().~T();
+      m_has_value = false;
+    }
+  }
+  T& get() { return *reinterpret_cast<T*>(&m_storage); }
+private:
+  typename std::aligned_storage<sizeof(T), alignof(T)>::type m_storage;
+  bool m_has_value;
+};
+
+template <class T>
+class slot_result_cache<T&> {
+public:
+  slot_result_cache() : m_value(nullptr) {};
+  template <class F>
+  void emplace(F&& fn) { m_value = &fn(); }
+  void reset() { m_value = nullptr; }
+  T& get() { return *m_value; }
+private:
+  T* m_value;
+};
+
+template <>
+class slot_result_cache<void> {
+public:
+  template <class F>
+  void emplace(F&& fn) { fn(); }
+  void reset() {}
+  void get() {}
+};
+
+/**
+ *  Shared state for a single combined emit
+ *  The arguments are kept by reference and the slot list is re-read on every access
+ *  because slots are allowed to connect (and reallocate the list) while we iterate
+ */
+template <class SlotList, class R, class... Args>
+struct slot_call_state {
+  using size_type = typename SlotList::size_type;
+  slot_call_state(const SlotList& list, Args&... arguments)
+  : slots(list), args(arguments...), cached_index(std::numeric_limits<size_type>::max()), calls(0) {};
+  const SlotList& slots;
+  std::tuple<Args&...> args;
+  slot_result_cache<R> cache;
+  size_type cached_index;
+  // number of slots called so far
+  size_type calls;
+};
+
+/**
+ *  Input iterator handed to combiners
+ *  Dereferencing calls the slot under the iterator (once, the result is cached) and
+ *  incrementing skips over disconnected slots. Slots past the point where the combiner
+ *  stops iterating are never called.
+ */
+template <class SlotList, class R, class... Args>
+class slot_call_iterator {
+  using state_type = slot_call_state<SlotList, R, Args...>;
+public:
+  using size_type = typename SlotList::size_type;
+  using iterator_category = std::input_iterator_tag;
+  using value_type = typename std::conditional<std::is_void<R>::value, void, typename std::decay<R>::type>::type;
+  using difference_type = std::ptrdiff_t;
+  using reference = typename std::conditional<std::is_reference<R>::value || std::is_void<R>::value, R,
+                                              typename std::add_lvalue_reference<R>::type>::type;
+  using pointer = typename std::add_pointer<typename std::remove_reference<R>::type>::type;
+
+  slot_call_iterator() : m_state(nullptr), m_index(0), m_end(0) {};
+  slot_call_iterator(state_type& state, size_type index, size_type end)
+  : m_state(&state), m_index(index), m_end(end) {
+    skip_disconnected();
+  };
+  slot_call_iterator(const slot_call_iterator&) = default;
+  slot_call_iterator& operator=(const slot_call_iterator&) = default;
+
+  reference operator*() const {
+    auto& state = *m_state;
+    if (state.cached_index != m_index) {
+      auto index = m_index;
+      state.cache.emplace([&] () -> R {
+        return apply_lvalues([&] (Args&... args) -> R {
+          return state.slots.invoke(index, args...);
+        }, state.args);
+      });
+      state.cached_index = m_index;
+      state.calls++;
+    }
+    return state.cache.get();
+  }
+  pointer operator->() const {
+    return &**this;
+  }
+  slot_call_iterator& operator++() {
+    ++m_index;
+    skip_disconnected();
+    return *this;
+  }
+  slot_call_iterator operator++(int) {
+    slot_call_iterator it(*this);
+    ++(*this);
+    return it;
+  }
+  bool operator==(const slot_call_iterator& other) const {
+    return m_index == other.m_index;
+  }
+  bool operator!=(const slot_call_iterator& other) const {
+    return !(*this == other);
+  }
+private:
+  void skip_disconnected() {
+    while (m_index < m_end && !m_state->slots.connected(m_index)) ++m_index;
+  }
+  state_type* m_state;
+  size_type m_index;
+  size_type m_end;
+};
 }}
 
 
@@ -0,0 +1,738 @@
+//
+//  slot_storage.h
+//  slimsig
+//
+//  Slot containers used by signal_base
+//
+//  Both containers keep slots sorted by id (new slots always get a higher id) and are addressed
+//  by index, since slots may be added while the signal is iterating and any reference into the
+//  container can be invalidated by the next connect.
+//
+
+#ifndef slimsig_slot_storage_h
+#define slimsig_slot_storage_h
+
+#include <vector>
+#include <iterator>
+#include <algorithm>
+#include <limits>
+#include <cstdint>
+#include <cstddef>
+#include <utility>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+#include "../tracing.h"
+#include "inline_allocator.h"
+
+namespace slimsig {
+
+enum class slot_layout {
+  // one vector of basic_slot, callable, id and flags side by side, plus a liveness bitset
+  interleaved,
+  // parallel arrays of callables, ids and a liveness bitset
+  split
+};
+
+namespace detail {
+
+[[gnu::always_inline]]
+inline unsigned count_trailing_zeros(std::uint64_t word)
+{
+#if defined(_MSC_VER)
+  unsigned long index;
+  _BitScanForward64(&index, word);
+  return unsigned(index);
+#else
+  return unsigned(__builtin_ctzll(word));
+#endif
+}
+
+// hint that address is about to be read, never faults
+[[gnu::always_inline]]
+inline void prefetch(const void* address)
+{
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+  _mm_prefetch(static_cast<const char*>(address), _MM_HINT_T0);
+#elif !defined(_MSC_VER)
+  __builtin_prefetch(address);
+#else
+  (void)address;
+#endif
+}
+
+// allocators are only swapped when they propagate on swap, some (polymorphic_allocator) can't even be assigned
+template <class Alloc>
+void swap_allocators(Alloc& lhs, Alloc& rhs, std::true_type)
+{
+  using std::swap;
+  swap(lhs, rhs);
+}
+template <class Alloc>
+void swap_allocators(Alloc&, Alloc&, std::false_type) {}
+template <class Alloc>
+void swap_allocators(Alloc& lhs, Alloc& rhs)
+{
+  swap_allocators(lhs, rhs, typename std::allocator_traits<Alloc>::propagate_on_container_swap{});
+}
+
+// swaps the contents of two vectors, element by element if their allocators can't trade storage
+template <class Vector>
+void swap_contents(Vector& lhs, Vector& rhs)
+{
+  using traits = std::allocator_traits<typename Vector::allocator_type>;
+  if (traits::propagate_on_container_swap::value || lhs.get_allocator() == rhs.get_allocator()) {
+    lhs.swap(rhs);
+    return;
+  }
+  auto* shorter = &lhs;
+  auto* longer = &rhs;
+  if (shorter->size() > longer->size()) std::swap(shorter, longer);
+  auto common = shorter->size();
+  std::swap_ranges(shorter->begin(), shorter->end(), longer->begin());
+  shorter->insert(shorter->end(), std::make_move_iterator(longer->begin() + common), std::make_move_iterator(longer->end()));
+  longer->erase(longer->begin() + common, longer->end());
+}
+
+// reallocates v to hold capacity elements (at least its size), only ever shrinks it
+template <class Vector>
+void shrink_capacity(Vector& v, typename Vector::size_type capacity)
+{
+  capacity = std::max(capacity, v.size());
+  if (capacity >= v.capacity()) return;
+  Vector shrunk(v.get_allocator());
+  shrunk.reserve(capacity);
+  std::move(v.begin(), v.end(), std::back_inserter(shrunk));
+  v.swap(shrunk);
+}
+// bytes v has allocated for its elements
+template <class Vector>
+std::size_t allocated_bytes(const Vector& v)
+{
+  return v.capacity() * sizeof(typename Vector::value_type);
+}
+
+/**
+ *  One bit per slot, set while the slot is connected
+ *
+ *  Emit loops scan it a word at a time and jump straight to the next live slot with
+ *  count_trailing_zeros, so a run of disconnected slots costs one load per 64 slots instead of
+ *  touching every one of them.
+ */
+template <class Allocator>
+class liveness_bitmap {
+  using word_type = std::uint64_t;
+  static constexpr std::size_t word_bits = 64;
+public:
+  using size_type = std::size_t;
+  using allocator_type = typename std::allocator_traits<Allocator>::template rebind_alloc<word_type>;
+
+  explicit liveness_bitmap(const allocator_type& alloc) : m_words(alloc) {};
+
+  static inline size_type words_for(size_type count) { return (count + word_bits - 1) / word_bits; }
+  inline void reserve(size_type count) { m_words.reserve(words_for(count)); }
+  inline size_type capacity() const { return m_words.capacity() * word_bits; }
+  // keeps room for count bits, at least the ones stored
+  inline void shrink_to(size_type count) { shrink_capacity(m_words, words_for(count)); }
+  inline const void* data() const { return m_words.data(); }
+  inline size_type allocated_size() const { return allocated_bytes(m_words); }
+
+  [[gnu::always_inline]]
+  inline bool test(size_type index) const { return (m_words[index / word_bits] & bit(index)) != 0; }
+  [[gnu::always_inline]]
+  inline void set(size_type index) { m_words[index / word_bits] |= bit(index); }
+  [[gnu::always_inline]]
+  inline void reset(size_type index) { m_words[index / word_bits] &= ~bit(index); }
+
+  // index has to be the number of bits pushed so far
+  [[gnu::always_inline]]
+  inline void push_back(size_type index, bool live)
+  {
+    if (index % word_bits == 0) m_words.push_back(0);
+    if (live) set(index);
+  }
+  // the first count bits set and nothing after them
+  void fill(size_type count)
+  {
+    m_words.assign(words_for(count), ~word_type(0));
+    if (count % word_bits) m_words.back() = low_bits(count);
+  }
+  // drops every bit from count on
+  void truncate(size_type count)
+  {
+    m_words.resize(words_for(count));
+    if (count % word_bits) m_words.back() &= low_bits(count);
+  }
+  void clear() { m_words.clear(); }
+  // the first set bit in [begin, end), or end if there isn't one
+  [[gnu::always_inline]]
+  inline size_type next_set(size_type begin, size_type end) const
+  {
+    if (begin >= end) return end;
+    // the next slot is usually live, only scan for it when it isn't
+    if (test(begin)) return begin;
+    auto word_index = begin / word_bits, last = (end - 1) / word_bits;
+    auto word = m_words[word_index] & (~word_type(0) << (begin % word_bits));
+    while (!word) {
+      if (++word_index > last) return end;
+      word = m_words[word_index];
+    }
+    return std::min(end, word_index * word_bits + size_type(count_trailing_zeros(word)));
+  }
+  void swap(liveness_bitmap& other) { swap_contents(m_words, other.m_words); }
+
+  // calls fn(index) for every set bit in [begin, end), skipping bits reset by an earlier call.
+  // Full words are walked bit by bit, which predicts perfectly; anything sparser jumps from one
+  // set bit to the next with count_trailing_zeros, and upcoming(next) gets the bit after the one
+  // about to be called so the caller can prefetch whatever that call will touch
+  template <class Fn, class Upcoming>
+  [[gnu::always_inline]]
+  inline void for_each_set(size_type begin, size_type end, const Fn& fn, const Upcoming& upcoming) const
+  {
+    if (begin >= end) return;
+    auto first = begin / word_bits, last = (end - 1) / word_bits;
+    for (auto word_index = first; word_index <= last; word_index++) {
+      auto word = m_words[word_index];
+      if (word_index == first) word &= ~word_type(0) << (begin % word_bits);
+      if (word_index == last && end % word_bits) word &= low_bits(end);
+      auto base = word_index * word_bits;
+      // fn may connect slots and reallocate the words, so always go back through m_words
+      if (word == ~word_type(0)) {
+        for (size_type index = base; index != base + word_bits; index++) {
+          if (m_words[word_index] & bit(index)) fn(index);
+        }
+        continue;
+      }
+      while (word) {
+        auto index = base + size_type(count_trailing_zeros(word));
+        word &= word - 1;
+        if (word) upcoming(base + size_type(count_trailing_zeros(word)));
+        if (m_words[word_index] & bit(index)) fn(index);
+      }
+    }
+  }
+private:
+  static inline word_type bit(size_type index) { return word_type(1) << (index % word_bits); }
+  static inline word_type low_bits(size_type count) { return (word_type(1) << (count % word_bits)) - 1; }
+  std::vector<word_type, allocator_type> m_words;
+};
+
+// connected slots of each slot_kind. Slots disconnect_all drops while emitting stay counted until
+// the next compaction, which only means emit asks kind(index) for a while longer than it needs to
+struct kind_counts {
+  std::size_t counts[3] = {};
+  [[gnu::always_inline]]
+  inline bool any(slot_kind kind) const { return counts[std::size_t(kind)] != 0; }
+  [[gnu::always_inline]]
+  inline void add(slot_kind kind, bool live) { counts[std::size_t(kind)] += live; }
+  [[gnu::always_inline]]
+  inline void remove(slot_kind kind) { counts[std::size_t(kind)]--; }
+  void clear() { *this = kind_counts(); }
+};
+
+// stands in for a callable that grow_while_running left in the old array, the call in progress
+// (and any state the callable keeps) stays with the original until release_retired moves it back
+template <class Callback>
+struct parked_callable {
+  const Callback* target;
+  template <class... Args>
+  [[gnu::always_inline]]
+  inline auto operator()(Args&&... args) const -> decltype((*target)(std::forward<Args>(args)...)) {
+    return (*target)(std::forward<Args>(args)...);
+  }
+};
+
+/**
+ *  Array of basic_slot values, what signals have always used
+ *
+ *  A liveness_bitmap next to the array mirrors each slot's connected flag so emit can skip
+ *  disconnected slots without loading them.
+ *
+ *  With InlineSlots > 0 the first InlineSlots slots live inside the slot_vector itself and the
+ *  array only moves to the heap once it outgrows them.
+ */
+template <class Slot, std::size_t InlineSlots = 0, class Allocator = std::allocator<Slot>>
+class slot_vector {
+  using storage_type = inline_storage<Slot, InlineSlots, Allocator>;
+  using live_storage_type = inline_storage<std::uint64_t, (InlineSlots + 63) / 64, Allocator>;
+  using bitmap_type = liveness_bitmap<typename live_storage_type::allocator_type>;
+  template <class T>
+  using rebind = typename std::allocator_traits<Allocator>::template rebind_alloc<T>;
+public:
+  using allocator_type = Allocator;
+  using slot = Slot;
+  using callback = typename slot::callback;
+  using slot_id = typename slot::slot_id;
+  using container_type = std::vector<slot, typename storage_type::allocator_type>;
+  using size_type = typename container_type::size_type;
+  using iterator = typename container_type::iterator;
+  using const_iterator = typename container_type::const_iterator;
+  using reference = typename container_type::reference;
+  using const_reference = typename container_type::const_reference;
+
+  // claim the whole inline buffer up front, otherwise the first one-slot allocation would take it
+  explicit slot_vector(const Allocator& alloc = Allocator())
+  : m_storage(), m_live_storage(), m_slots(m_storage.allocator(alloc)), m_live(m_live_storage.allocator(alloc)),
+    m_retired(alloc), m_released(alloc) {
+    if (InlineSlots > 0) reserve(InlineSlots);
+  };
+  slot_vector(const slot_vector&) = delete;
+  slot_vector& operator=(const slot_vector&) = delete;
+
+  inline size_type size() const { return m_slots.size(); }
+  inline size_type capacity() const { return m_slots.capacity(); }
+  inline size_type max_size() const { return m_slots.max_size(); }
+  inline void reserve(size_type capacity)
+  {
+    m_slots.reserve(capacity);
+    m_live.reserve(capacity);
+  }
+  inline iterator begin() { return m_slots.begin(); }
+  inline iterator end() { return m_slots.end(); }
+  inline const_iterator begin() const { return m_slots.begin(); }
+  inline const_iterator end() const { return m_slots.end(); }
+
+  template <class... SlotArgs>
+  [[gnu::always_inline]]
+  inline void emplace_back(bool running, slot_id sid, std::uint32_t handle, slot_kind kind, SlotArgs&&... args)
+  {
+    if (running && m_slots.size() == m_slots.capacity()) grow_while_running();
+    m_slots.emplace_back(sid, std::forward<SlotArgs>(args)...);
+    auto& slot = m_slots.back();
+    slot.m_handle = handle;
+    slot.m_kind = kind;
+    m_kinds.add(kind, bool(slot));
+    m_live.push_back(m_slots.size() - 1, bool(slot));
+  }
+
+  [[gnu::always_inline]]
+  inline bool connected(size_type index) const { return m_live.test(index); }
+  [[gnu::always_inline]]
+  inline std::uint32_t handle(size_type index) const { return m_slots[index].m_handle; }
+  [[gnu::always_inline]]
+  inline slot_kind kind(size_type index) const { return m_slots[index].m_kind; }
+  [[gnu::always_inline]]
+  inline const callback& callable(size_type index) const { return m_slots[index].m_fn; }
+  // the first connected slot in [begin, end), or end
+  [[gnu::always_inline]]
+  inline size_type next_connected(size_type begin, size_type end) const { return m_live.next_set(begin, end); }
+  // false means no connected slot is of that kind, so emit loops can skip asking kind(index)
+  [[gnu::always_inline]]
+  inline bool has_slots(slot_kind kind) const { return m_kinds.any(kind); }
+
+  template <class... Args>
+  [[gnu::always_inline]]
+  inline auto invoke(size_type index, Args&&... args) const -> decltype(std::declval<const slot&>()(std::forward<Args>(args)...))
+  {
+    if (tracer::enabled()) return detail::traced_call(m_slots[index].m_slot_id, m_slots[index], std::forward<Args>(args)...);
+    return m_slots[index](std::forward<Args>(args)...);
+  }
+
+  // calls fn(index) for every connected slot in [begin, end), skipping dead slots through the
+  // bitmap rather than loading each one. Slots disconnected by an earlier call are skipped
+  template <class Fn>
+  [[gnu::always_inline]]
+  inline void for_each_connected(size_type begin, size_type end, const Fn& fn) const
+  {
+    auto slots = m_slots.data();
+    m_live.for_each_set(begin, end, fn, [slots] (size_type next) { prefetch(slots + next); });
+  }
+
+  // while the signal is emitting the callable is kept until release_retired(), the slot may be
+  // running or (a once slot claimed by the emit loop) just about to be called
+  [[gnu::always_inline]]
+  inline void disconnect(size_type index, bool running)
+  {
+    auto& slot = m_slots[index];
+    m_kinds.remove(slot.m_kind);
+    if (running) {
+      slot.m_is_connected = false;
+      m_released.push_back(index);
+    } else {
+      slot.disconnect();
+    }
+    m_live.reset(index);
+  }
+
+  // drops [0, offset) (slots removed by disconnect_all while emitting) and every disconnected slot
+  void compact(size_type offset)
+  {
+    m_slots.erase(m_slots.begin(), m_slots.begin() + offset);
+    m_slots.erase(std::remove_if(m_slots.begin(), m_slots.end(), &is_disconnected), m_slots.end());
+    m_live.fill(m_slots.size());
+    // slots dropped by disconnect_all were never disconnected one by one
+    m_kinds.clear();
+    for (auto& slot : m_slots) m_kinds.add(slot.m_kind, true);
+    m_retired.clear();
+    m_released.clear();
+    m_compact_read = m_compact_write = 0;
+  }
+  // one step of an incremental compaction: examines up to budget slots, sliding connected ones
+  // down over the disconnected ones and calling moved(index) for each slot that moved.
+  // Between steps the slots in the gap left behind look disconnected, so emit just skips them.
+  // Returns true once the pass reaches the end and the gap has been trimmed off
+  template <class Moved>
+  bool compact_some(size_type budget, const Moved& moved)
+  {
+    auto end = m_slots.size();
+    for (; m_compact_read < end && budget > 0; m_compact_read++, budget--) {
+      if (!m_live.test(m_compact_read)) continue;
+      if (m_compact_write != m_compact_read) {
+        m_slots[m_compact_write] = std::move(m_slots[m_compact_read]);
+        m_slots[m_compact_read].disconnect();
+        m_live.set(m_compact_write);
+        m_live.reset(m_compact_read);
+        moved(m_compact_write);
+      }
+      m_compact_write++;
+    }
+    if (m_compact_read < end) return false;
+    m_slots.erase(m_slots.begin() + m_compact_write, m_slots.end());
+    m_live.truncate(m_compact_write);
+    m_compact_read = m_compact_write = 0;
+    return true;
+  }
+  // once the outermost emit is over nothing can be running, so callables parked by
+  // grow_while_running move back and callables disconnected while emitting can go
+  void release_retired()
+  {
+    // each array forwards to the one retired before it, so starting from the oldest every
+    // callable ends up in the array that's live now
+    for (size_type age = 0; age < m_retired.size(); age++) {
+      auto& parked = m_retired[age];
+      auto& next = age + 1 < m_retired.size() ? m_retired[age + 1] : m_slots;
+      for (size_type index = 0; index < parked.size(); index++) next[index].m_fn = std::move(parked[index].m_fn);
+    }
+    for (auto index : m_released) {
+      if (!m_slots[index]) m_slots[index].m_fn = nullptr;
+    }
+    m_released.clear();
+    m_retired.clear();
+  }
+  void clear()
+  {
+    m_slots.clear();
+    m_live.clear();
+    m_kinds.clear();
+    m_compact_read = m_compact_write = 0;
+  }
+  // reallocates to fit capacity slots (never fewer than are stored or fit inline), never while emitting
+  void shrink_to(size_type capacity)
+  {
+    capacity = std::max({ capacity, m_slots.size(), InlineSlots });
+    if (capacity >= m_slots.capacity()) return;
+    shrink_capacity(m_slots, capacity);
+    m_live.shrink_to(capacity);
+    shrink_capacity(m_retired, 0);
+    shrink_capacity(m_released, 0);
+  }
+  // heap bytes held by the slot list and its callables, inline slots are part of the signal
+  size_type memory_usage() const
+  {
+    size_type bytes = allocated_bytes(m_retired) + allocated_bytes(m_released);
+    if (!m_storage.owns(m_slots.data())) bytes += allocated_bytes(m_slots);
+    if (!m_live_storage.owns(m_live.data())) bytes += m_live.allocated_size();
+    for (auto& slot : m_slots) bytes += slot.m_fn.allocated_size();
+    for (auto& retired : m_retired) {
+      bytes += allocated_bytes(retired);
+      for (auto& slot : retired) bytes += slot.m_fn.allocated_size();
+    }
+    return bytes;
+  }
+  // never called while emitting, so nothing is retired and no slot is running
+  void swap(slot_vector& other)
+  {
+    // each vector may be using its own inline buffer or allocator, then the slots trade places instead
+    swap_contents(m_slots, other.m_slots);
+    m_live.swap(other.m_live);
+    swap_contents(m_retired, other.m_retired);
+    swap_contents(m_released, other.m_released);
+    std::swap(m_kinds, other.m_kinds);
+    std::swap(m_compact_read, other.m_compact_read);
+    std::swap(m_compact_write, other.m_compact_write);
+  }
+private:
+  static bool is_disconnected(const_reference slot) {  return !bool(slot); };
+
+  // Slots keep their callables inline, so letting the vector reallocate while a slot is executing
+  // would move the callable out from under it. Instead we grow into a new buffer ourselves and
+  // park the old one until the outermost emit finishes. Any slot might be running, possibly more
+  // than once, so none of the callables move: the new slots forward to them, see parked_callable
+  void grow_while_running()
+  {
+    // the old array may be the inline buffer, which stays out of use until m_retired lets go of it
+    container_type grown(m_slots.get_allocator());
+    grown.reserve(std::max<size_type>(4, m_slots.capacity() * 2));
+    for (auto& slot : m_slots) {
+      grown.emplace_back(slot.m_slot_id, parked_callable<callback>{ &slot.m_fn });
+      auto& moved = grown.back();
+      moved.m_handle = slot.m_handle;
+      moved.m_is_connected = slot.m_is_connected;
+      moved.m_kind = slot.m_kind;
+    }
+    m_slots.swap(grown);
+    m_retired.push_back(std::move(grown));
+  }
+  storage_type m_storage;
+  live_storage_type m_live_storage;
+  container_type m_slots;
+  bitmap_type m_live;
+  std::vector<container_type, rebind<container_type>> m_retired;
+  // slots disconnected while the signal was emitting
+  std::vector<size_type, rebind<size_type>> m_released;
+  kind_counts m_kinds;
+  // where an incremental compaction left off, see compact_some
+  size_type m_compact_read = 0;
+  size_type m_compact_write = 0;
+};
+
+/**
+ *  Structure-of-arrays slot storage
+ *
+ *  Callables, ids, connection handles and liveness are kept in separate arrays so emit only
+ *  streams the callables and a packed bitset.
+ *  Disconnected callables are kept around until the next compaction instead of being destroyed
+ *  right away, which means we don't need a running flag per slot either.
+ */
+template <class Callback, class SlotID, class Allocator = std::allocator<Callback>>
+class slot_columns {
+  template <class T>
+  using vector = std::vector<T, typename std::allocator_traits<Allocator>::template rebind_alloc<T>>;
+public:
+  using allocator_type = Allocator;
+  using callback = Callback;
+  using slot_id = SlotID;
+  using size_type = std::size_t;
+
+  explicit slot_columns(const Allocator& alloc = Allocator())
+  : m_callables(alloc), m_ids(alloc), m_handles(alloc), m_kinds(alloc), m_live(alloc), m_retired(alloc), m_released(alloc) {};
+  slot_columns(const slot_columns&) = delete;
+  slot_columns& operator=(const slot_columns&) = delete;
+
+  inline size_type size() const { return m_ids.size(); }
+  inline size_type capacity() const { return m_callables.capacity(); }
+  inline size_type max_size() const { return m_callables.max_size(); }
+  inline void reserve(size_type capacity)
+  {
+    m_callables.reserve(capacity);
+    m_ids.reserve(capacity);
+    m_handles.reserve(capacity);
+    m_live.reserve(capacity);
+    m_kinds.reserve(capacity);
+  }
+
+  template <class... SlotArgs>
+  [[gnu::always_inline]]
+  inline void emplace_back(bool running, slot_id sid, std::uint32_t handle, slot_kind kind, SlotArgs&&... args)
+  {
+    if (running && m_callables.size() == m_callables.capacity()) grow_while_running();
+    m_callables.emplace_back(std::forward<SlotArgs>(args)...);
+    auto index = m_ids.size();
+    auto live = bool(m_callables.back());
+    m_ids.push_back(sid);
+    m_handles.push_back(handle);
+    m_kinds.push_back(kind);
+    m_kind_counts.add(kind, live);
+    m_live.push_back(index, live);
+  }
+
+  [[gnu::always_inline]]
+  inline bool connected(size_type index) const
+  {
+    return m_live.test(index);
+  }
+  [[gnu::always_inline]]
+  inline std::uint32_t handle(size_type index) const { return m_handles[index]; }
+  [[gnu::always_inline]]
+  inline slot_kind kind(size_type index) const { return m_kinds[index]; }
+  [[gnu::always_inline]]
+  inline const callback& callable(size_type index) const { return m_callables[index]; }
+  [[gnu::always_inline]]
+  inline size_type next_connected(size_type begin, size_type end) const { return m_live.next_set(begin, end); }
+  // see slot_vector::has_slots
+  [[gnu::always_inline]]
+  inline bool has_slots(slot_kind kind) const { return m_kind_counts.any(kind); }
+
+  template <class... Args>
+  [[gnu::always_inline]]
+  inline auto invoke(size_type index, Args&&... args) const -> decltype(std::declval<const callback&>()(std::forward<Args>(args)...))
+  {
+    if (tracer::enabled()) return detail::traced_call(m_ids[index], m_callables[index], std::forward<Args>(args)...);
+    return m_callables[index](std::forward<Args>(args)...);
+  }
+
+  // calls fn(index) for every connected slot in [begin, end), see liveness_bitmap::for_each_set
+  template <class Fn>
+  [[gnu::always_inline]]
+  inline void for_each_connected(size_type begin, size_type end, const Fn& fn) const
+  {
+    auto callables = m_callables.data();
+    m_live.for_each_set(begin, end, fn, [callables] (size_type next) { prefetch(callables + next); });
+  }
+
+  // the callable is released right away unless the signal is emitting, in which case it might be
+  // running and is kept until release_retired()
+  [[gnu::always_inline]]
+  inline void disconnect(size_type index, bool running)
+  {
+    m_live.reset(index);
+    m_kind_counts.remove(m_kinds[index]);
+    if (!running) m_callables[index] = nullptr;
+    else m_released.push_back(index);
+  }
+
+  void compact(size_type offset)
+  {
+    size_type out = 0;
+    for (size_type i = offset, end = size(); i != end; i++) {
+      if (!connected(i)) continue;
+      if (out != i) {
+        m_callables[out] = std::move(m_callables[i]);
+        m_ids[out] = m_ids[i];
+        m_handles[out] = m_handles[i];
+        m_kinds[out] = m_kinds[i];
+      }
+      ++out;
+    }
+    m_callables.erase(m_callables.begin() + out, m_callables.end());
+    m_ids.erase(m_ids.begin() + out, m_ids.end());
+    m_handles.erase(m_handles.begin() + out, m_handles.end());
+    m_kinds.erase(m_kinds.begin() + out, m_kinds.end());
+    m_live.fill(out);
+    m_kind_counts.clear();
+    for (auto kind : m_kinds) m_kind_counts.add(kind, true);
+    m_retired.clear();
+    m_released.clear();
+    m_compact_read = m_compact_write = 0;
+  }
+  // see slot_vector::compact_some
+  template <class Moved>
+  bool compact_some(size_type budget, const Moved& moved)
+  {
+    auto end = size();
+    for (; m_compact_read < end && budget > 0; m_compact_read++, budget--) {
+      if (!connected(m_compact_read)) continue;
+      auto read = m_compact_read, write = m_compact_write;
+      if (write != read) {
+        m_callables[write] = std::move(m_callables[read]);
+        m_callables[read] = nullptr;
+        m_ids[write] = m_ids[read];
+        m_handles[write] = m_handles[read];
+        m_kinds[write] = m_kinds[read];
+        m_live.set(write);
+        m_live.reset(read);
+        moved(write);
+      }
+      m_compact_write++;
+    }
+    if (m_compact_read < end) return false;
+    auto out = m_compact_write;
+    m_callables.erase(m_callables.begin() + out, m_callables.end());
+    m_ids.erase(m_ids.begin() + out, m_ids.end());
+    m_handles.erase(m_handles.begin() + out, m_handles.end());
+    m_kinds.erase(m_kinds.begin() + out, m_kinds.end());
+    m_live.truncate(out);
+    m_compact_read = m_compact_write = 0;
+    return true;
+  }
+  // see slot_vector::release_retired
+  void release_retired()
+  {
+    for (size_type age = 0; age < m_retired.size(); age++) {
+      auto& parked = m_retired[age];
+      auto& next = age + 1 < m_retired.size() ? m_retired[age + 1] : m_callables;
+      for (size_type index = 0; index < parked.size(); index++) next[index] = std::move(parked[index]);
+    }
+    for (auto index : m_released) {
+      if (!connected(index)) m_callables[index] = nullptr;
+    }
+    m_released.clear();
+    m_retired.clear();
+  }
+  void clear()
+  {
+    m_callables.clear();
+    m_ids.clear();
+    m_handles.clear();
+    m_kinds.clear();
+    m_kind_counts.clear();
+    m_live.clear();
+    m_compact_read = m_compact_write = 0;
+  }
+  // see slot_vector::shrink_to
+  void shrink_to(size_type capacity)
+  {
+    capacity = std::max(capacity, m_ids.size());
+    if (capacity >= m_callables.capacity()) return;
+    shrink_capacity(m_callables, capacity);
+    shrink_capacity(m_ids, capacity);
+    shrink_capacity(m_handles, capacity);
+    shrink_capacity(m_kinds, capacity);
+    m_live.shrink_to(capacity);
+    shrink_capacity(m_retired, 0);
+    shrink_capacity(m_released, 0);
+  }
+  size_type memory_usage() const
+  {
+    size_type bytes = allocated_bytes(m_callables) + allocated_bytes(m_ids) + allocated_bytes(m_handles) +
+                      allocated_bytes(m_kinds) + m_live.allocated_size() + allocated_bytes(m_retired) +
+                      allocated_bytes(m_released);
+    for (auto& fn : m_callables) bytes += fn.allocated_size();
+    for (auto& retired : m_retired) {
+      bytes += allocated_bytes(retired);
+      for (auto& fn : retired) bytes += fn.allocated_size();
+    }
+    return bytes;
+  }
+  void swap(slot_columns& other)
+  {
+    swap_contents(m_callables, other.m_callables);
+    swap_contents(m_ids, other.m_ids);
+    swap_contents(m_handles, other.m_handles);
+    m_live.swap(other.m_live);
+    swap_contents(m_kinds, other.m_kinds);
+    std::swap(m_kind_counts, other.m_kind_counts);
+    swap_contents(m_retired, other.m_retired);
+    swap_contents(m_released, other.m_released);
+    std::swap(m_compact_read, other.m_compact_read);
+    std::swap(m_compact_write, other.m_compact_write);
+  }
+private:
+  // we don't track which callables are running, so like slot_vector none of them move: the old
+  // array is kept until the outermost emit finishes and the new one forwards to it
+  void grow_while_running()
+  {
+    vector<callback> grown(m_callables.get_allocator());
+    grown.reserve(std::max<size_type>(4, m_callables.capacity() * 2));
+    for (auto& fn : m_callables) grown.emplace_back(parked_callable<callback>{ &fn });
+    m_callables.swap(grown);
+    m_retired.push_back(std::move(grown));
+  }
+  vector<callback> m_callables;
+  vector<slot_id> m_ids;
+  vector<std::uint32_t> m_handles;
+  vector<slot_kind> m_kinds;
+  liveness_bitmap<Allocator> m_live;
+  vector<vector<callback>> m_retired;
+  vector<size_type> m_released;
+  kind_counts m_kind_counts;
+  size_type m_compact_read = 0;
+  size_type m_compact_write = 0;
+};
+
+template <class Slot, std::size_t InlineSlots, class Allocator>
+inline void swap(slot_vector<Slot, InlineSlots, Allocator>& lhs, slot_vector<Slot, InlineSlots, Allocator>& rhs)
+{
+  lhs.swap(rhs);
+}
+template <class Callback, class SlotID, class Allocator>
+inline void swap(slot_columns<Callback, SlotID, Allocator>& lhs, slot_columns<Callback, SlotID, Allocator>& rhs)
+{
+  lhs.swap(rhs);
+}
+
+}
+}
+
+#endif
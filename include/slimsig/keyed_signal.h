@@ -0,0 +1,168 @@
+//
+//  keyed_signal.h
+//  slimsig
+//
+//  A signal whose slots subscribe to a key and only hear emits for that key
+//
+
+#ifndef slimsig_keyed_signal_h
+#define slimsig_keyed_signal_h
+
+#include <functional>
+#include <memory>
+#include <tuple>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+#include "slimsig.h"
+
+namespace slimsig {
+
+template <
+  class Key,
+  class Handler,
+  class SignalTraits = signal_traits<Handler>,
+  class Allocator = std::allocator<std::function<Handler>>,
+  class Hash = std::hash<Key>,
+  class KeyEqual = std::equal_to<Key>
+> class keyed_signal;
+
+/**
+ *  Routes every emit to the slots connected under its key
+ *
+ *  connect(key, fn) files the slot under key and emit(key, args...) only calls the slots filed
+ *  there, so an emit costs O(matching slots) instead of every slot filtering for itself. Each key
+ *  has its own signal, which means connecting and disconnecting from inside slots (under any key)
+ *  behaves exactly like it does for signal. A key is dropped once an emit finds all its slots gone.
+ *
+ *  Wildcard slots, connected with connect_any, run after the keyed slots on every emit and get the
+ *  key as their first argument. emit returns what the combiner made of the keyed slots, or a
+ *  default constructed result when nothing is connected under the key; wildcard results are dropped.
+ *
+ *  Keys live in a node based std::unordered_map so a key's signal never moves, not even when a
+ *  slot adds keys while it is emitting and the table rehashes. Not thread safe.
+ */
+template <class Key, class SignalTraits, class Allocator, class Hash, class KeyEqual, class R, class... Args>
+class keyed_signal<Key, R(Args...), SignalTraits, Allocator, Hash, KeyEqual> {
+public:
+  using key_type = Key;
+  using signal_type = signal<R(Args...), SignalTraits, Allocator>;
+  using wildcard_signal_type = signal<R(const Key&, Args...), SignalTraits, Allocator>;
+  using allocator_type = Allocator;
+  using result_type = typename signal_type::result_type;
+  using connection = typename signal_type::connection;
+  using wildcard_connection = typename wildcard_signal_type::connection;
+  using size_type = std::size_t;
+  static_assert(std::is_same<typename SignalTraits::thread_policy, single_threaded>::value,
+                "keyed_signal's key index isn't thread safe, use a single threaded thread_policy");
+
+  explicit keyed_signal(const allocator_type& alloc = allocator_type())
+  : m_keys(0, Hash(), KeyEqual(), map_allocator(alloc)), m_any(alloc), m_allocator(alloc) {};
+  keyed_signal(keyed_signal&&) = default;
+  keyed_signal& operator=(keyed_signal&&) = default;
+  keyed_signal(const keyed_signal&) = delete;
+  keyed_signal& operator=(const keyed_signal&) = delete;
+
+  result_type emit(const key_type& key, Args... args) {
+    return emit_impl(std::is_void<result_type>{}, key, args...);
+  }
+  result_type operator()(const key_type& key, Args... args) {
+    return emit_impl(std::is_void<result_type>{}, key, args...);
+  }
+
+  template <class F>
+  connection connect(const key_type& key, F&& slot) {
+    return slots(key).connect(std::forward<F>(slot));
+  }
+  template <class F>
+  connection connect_once(const key_type& key, F&& slot) {
+    return slots(key).connect_once(std::forward<F>(slot));
+  }
+  template <class F>
+  connection connect_extended(const key_type& key, F&& slot) {
+    return slots(key).connect_extended(std::forward<F>(slot));
+  }
+  // slots called for every key, as fn(key, args...)
+  template <class F>
+  wildcard_connection connect_any(F&& slot) {
+    return m_any.connect(std::forward<F>(slot));
+  }
+
+  // keys whose signal is emitting are emptied now and dropped by their next emit
+  void disconnect_all() {
+    for (auto it = m_keys.begin(); it != m_keys.end();) {
+      it->second.disconnect_all();
+      it = it->second.is_running() ? std::next(it) : m_keys.erase(it);
+    }
+    m_any.disconnect_all();
+  }
+  void disconnect_all(const key_type& key) {
+    auto it = m_keys.find(key);
+    if (it == m_keys.end()) return;
+    it->second.disconnect_all();
+    if (!it->second.is_running()) m_keys.erase(it);
+  }
+
+  // every slot, keyed and wildcard
+  size_type slot_count() const {
+    size_type count = m_any.slot_count();
+    for (auto& entry : m_keys) count += entry.second.slot_count();
+    return count;
+  }
+  size_type slot_count(const key_type& key) const {
+    auto it = m_keys.find(key);
+    return it == m_keys.end() ? 0 : it->second.slot_count();
+  }
+  // keys with an entry in the index, including keys whose slots have all gone since their last emit
+  size_type key_count() const {
+    return m_keys.size();
+  }
+  bool empty() const {
+    return slot_count() == 0;
+  }
+  const allocator_type& get_allocator() const {
+    return m_allocator;
+  }
+private:
+  using map_allocator = typename std::allocator_traits<Allocator>::template rebind_alloc<std::pair<const Key, signal_type>>;
+  using key_map = std::unordered_map<Key, signal_type, Hash, KeyEqual, map_allocator>;
+
+  signal_type& slots(const key_type& key) {
+    auto it = m_keys.find(key);
+    if (it != m_keys.end()) return it->second;
+    return m_keys.emplace(std::piecewise_construct, std::forward_as_tuple(key), std::forward_as_tuple(m_allocator)).first->second;
+  }
+
+  void emit_impl(std::true_type, const key_type& key, Args&... args) {
+    emit_keyed(key, args...);
+    if (!m_any.empty()) m_any.emit(key, args...);
+  }
+  result_type emit_impl(std::false_type, const key_type& key, Args&... args) {
+    auto result = emit_keyed(key, args...);
+    if (!m_any.empty()) m_any.emit(key, args...);
+    return result;
+  }
+  result_type emit_keyed(const key_type& key, Args&... args) {
+    auto it = m_keys.find(key);
+    if (it == m_keys.end()) return detail::default_value<result_type>();
+    auto& slots = it->second;
+    // slots may add keys and rehash the table, so hold on to the signal rather than the iterator
+    struct prune_guard {
+      keyed_signal& self;
+      const key_type& key;
+      signal_type& slots;
+      ~prune_guard() {
+        if (slots.empty() && !slots.is_running()) self.m_keys.erase(key);
+      }
+    } guard { *this, key, slots };
+    return slots.emit(args...);
+  }
+
+  key_map m_keys;
+  wildcard_signal_type m_any;
+  allocator_type m_allocator;
+};
+
+}
+
+#endif
@@ -0,0 +1,181 @@
+//
+//  mailbox_signal.h
+//  slimsig
+//
+//  A signal that any thread can emit and whose slots only run on the thread that owns it
+//
+
+#ifndef slimsig_mailbox_signal_h
+#define slimsig_mailbox_signal_h
+
+#include <atomic>
+#include <cassert>
+#include <limits>
+#include <thread>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include "slimsig.h"
+#include "detail/mailbox_ring.h"
+
+namespace slimsig {
+
+// what emit from another thread, or post from any thread, does when the mailbox is full
+enum class overflow_policy {
+  // wait for the home thread to pump. The home thread itself pumps to make room, or, from a slot
+  // it's already pumping, throws the new event away like fail
+  block,
+  // throw away the oldest event that hasn't been pumped yet. If the home thread is pumping all of
+  // them, a post from one of its slots throws away the new event instead
+  drop_oldest,
+  // throw away the new event, emit returns false
+  fail
+};
+
+template <
+  class Handler,
+  class SignalTraits = signal_traits<Handler>,
+  class Allocator = std::allocator<std::function<Handler>>
+> class mailbox_signal;
+
+/**
+ *  signal owned by one thread, the home thread, that the others emit through a mailbox
+ *
+ *  emit() from the home thread calls the slots right away like any signal. From any other thread
+ *  it copies the arguments (references are stored by value too) into a bounded lock-free ring and
+ *  returns; the home thread calls pump() from its event loop to emit whatever has arrived. Slots
+ *  therefore always run on the home thread and the signal keeps the single threaded emit path,
+ *  no mutex is taken on either side. Events from one thread are pumped in the order they were
+ *  emitted; an emit on the home thread doesn't wait for events still sitting in the mailbox.
+ *
+ *  pump() emits a whole batch of events through emit_batch, so slots connecting and disconnecting
+ *  behave just like they do during emit. A slot that throws loses the rest of its batch.
+ *  Everything except emit() and dropped() has to be called on the home thread, the home thread is
+ *  the one that constructed the signal.
+ */
+template <class SignalTraits, class Allocator, class R, class... Args>
+class mailbox_signal<R(Args...), SignalTraits, Allocator> : public signal<R(Args...), SignalTraits, Allocator> {
+  using event = std::tuple<typename std::decay<Args>::type...>;
+  using ring_type = detail::mailbox_ring<event, typename std::allocator_traits<Allocator>::template rebind_alloc<event>>;
+public:
+  using signal_type = signal<R(Args...), SignalTraits, Allocator>;
+  using typename signal_type::allocator_type;
+  using size_type = std::size_t;
+
+  // capacity is rounded up to a power of two
+  explicit mailbox_signal(size_type capacity = 1024, overflow_policy policy = overflow_policy::block,
+                          const allocator_type& alloc = allocator_type())
+  : signal_type(alloc), m_mailbox(capacity, alloc), m_policy(policy), m_home(std::this_thread::get_id()),
+    m_dropped(0), m_pumping(false) {};
+  // producers hold on to the signal, so it can't move
+  mailbox_signal(const mailbox_signal&) = delete;
+  mailbox_signal& operator=(const mailbox_signal&) = delete;
+
+  // calls the slots now on the home thread, anywhere else queues the event for pump().
+  // false when the event was thrown away because the mailbox was full and the policy is fail
+  bool emit(Args... args) {
+    if (on_home_thread()) {
+      signal_type::emit(std::forward<Args>(args)...);
+      return true;
+    }
+    return post(std::forward<Args>(args)...);
+  }
+  bool operator()(Args... args) {
+    return emit(std::forward<Args>(args)...);
+  }
+
+  // queues the event whatever thread this is, even the home thread. Nobody else pumps, so the home
+  // thread never waits for room: see overflow_policy for what it does instead
+  bool post(Args... args) {
+    event e { std::forward<Args>(args)... };
+    if (m_mailbox.try_push(e)) return true;
+    switch (m_policy) {
+      case overflow_policy::block:
+        while (!m_mailbox.try_push(e)) {
+          if (!on_home_thread()) std::this_thread::yield();
+          else if (!m_pumping) pump();
+          else return reject();
+        }
+        return true;
+      case overflow_policy::drop_oldest:
+        while (!m_mailbox.try_push(e)) {
+          // the home thread may have claimed everything that's there, then room is on its way,
+          // unless this is the home thread posting from a slot it's pumping
+          if (m_mailbox.drop_oldest()) m_dropped.fetch_add(1, std::memory_order_relaxed);
+          else if (on_home_thread()) return reject();
+          else std::this_thread::yield();
+        }
+        return true;
+      case overflow_policy::fail:
+        break;
+    }
+    return reject();
+  }
+
+  // emits up to max of the events waiting in the mailbox, oldest first, and returns how many.
+  // Events that arrive while pumping are picked up too. Calling pump from a slot it's running
+  // does nothing, the outer pump carries on with the next batch
+  size_type pump(size_type max = std::numeric_limits<size_type>::max()) {
+    assert(on_home_thread() && "mailbox_signal can only be pumped by its home thread");
+    if (m_pumping) return 0;
+    pump_scope scope { *this };
+    size_type pumped = 0;
+    size_type first = 0;
+    while (pumped < max) {
+      auto count = m_mailbox.claim(max - pumped, first);
+      if (count == 0) break;
+      // claimed events stay in the ring until their batch is done, then their cells go back to producers
+      batch_guard guard { m_mailbox, first, count };
+      this->emit_batch(m_mailbox.at(first), m_mailbox.at(first + count));
+      pumped += count;
+    }
+    return pumped;
+  }
+
+  // events waiting to be pumped, a snapshot while other threads are emitting
+  size_type pending() const {
+    return m_mailbox.size();
+  }
+  size_type capacity() const {
+    return m_mailbox.capacity();
+  }
+  // events drop_oldest threw away or fail turned down, safe from any thread
+  size_type dropped() const {
+    return m_dropped.load(std::memory_order_relaxed);
+  }
+  overflow_policy policy() const {
+    return m_policy;
+  }
+  std::thread::id home() const {
+    return m_home;
+  }
+  bool on_home_thread() const {
+    return std::this_thread::get_id() == m_home;
+  }
+private:
+  bool reject() {
+    m_dropped.fetch_add(1, std::memory_order_relaxed);
+    return false;
+  }
+  struct pump_scope {
+    mailbox_signal& signal;
+    pump_scope(mailbox_signal& context) : signal(context) { signal.m_pumping = true; }
+    ~pump_scope() { signal.m_pumping = false; }
+  };
+  struct batch_guard {
+    ring_type& ring;
+    size_type first;
+    size_type count;
+    ~batch_guard() { ring.release(first, count); }
+  };
+
+  ring_type m_mailbox;
+  overflow_policy m_policy;
+  std::thread::id m_home;
+  std::atomic<size_type> m_dropped;
+  bool m_pumping;
+};
+
+}
+
+#endif
@@ -0,0 +1,182 @@
+//
+//  queued_signal.h
+//  slimsig
+//
+//  A signal that can queue emits and dispatch them later
+//
+
+#ifndef slimsig_queued_signal_h
+#define slimsig_queued_signal_h
+
+#include <tuple>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include "slimsig.h"
+#include "detail/apply.h"
+#include "detail/bump_arena.h"
+
+namespace slimsig {
+
+template <
+  class Handler,
+  class SignalTraits = signal_traits<Handler>,
+  class Allocator = std::allocator<std::function<Handler>>
+> class queued_signal;
+
+/**
+ *  signal plus a FIFO of deferred emits
+ *
+ *  emit_deferred() stores a copy of its arguments (references are stored by value too) and
+ *  returns without calling anything. flush() then emits every queued event in order, including
+ *  events queued by slots while flushing. Events are packed back to back in a bump_arena that is
+ *  rewound once the queue drains, so queueing doesn't allocate once the arena has grown to fit
+ *  a typical burst.
+ *
+ *  Like the rest of the signal the queue is not thread safe, even with a concurrent thread_policy.
+ */
+template <class SignalTraits, class Allocator, class R, class... Args>
+class queued_signal<R(Args...), SignalTraits, Allocator> : public signal<R(Args...), SignalTraits, Allocator> {
+  struct event {
+    template <class... T>
+    event(T&&... arguments) : args(std::forward<T>(arguments)...), next(nullptr) {};
+    std::tuple<typename std::decay<Args>::type...> args;
+    event* next;
+  };
+public:
+  using signal_type = signal<R(Args...), SignalTraits, Allocator>;
+  using typename signal_type::allocator_type;
+  using size_type = std::size_t;
+
+  using signal_type::signal_type;
+  queued_signal() : signal_type() {};
+  queued_signal(queued_signal&& other) : signal_type(std::move(other)) {
+    swap_queue(other);
+  }
+  queued_signal& operator=(queued_signal&& other) {
+    signal_type::operator=(std::move(other));
+    swap_queue(other);
+    return *this;
+  }
+  ~queued_signal() {
+    discard();
+  }
+
+  void emit_deferred(Args... args) {
+    push(::new (m_arena.allocate(sizeof(event), alignof(event))) event(std::forward<Args>(args)...));
+  }
+
+  // emits queued events until the queue is empty, returns how many were emitted
+  // calling flush from a slot that is being flushed does nothing, the outer flush picks up new events
+  size_type flush() {
+    if (m_flushing) return 0;
+    flush_scope scope { *this };
+    size_type count = 0;
+    while (m_head) {
+      auto e = pop();
+      event_guard guard { e };
+      dispatch(*e, detail::make_index_sequence<sizeof...(Args)>{});
+      count++;
+    }
+    return count;
+  }
+
+  // drops every queued event without emitting it
+  void discard() {
+    while (m_head) {
+      event_guard guard { pop() };
+    }
+    if (!m_flushing) m_arena.reset();
+  }
+
+  size_type queued() const {
+    return m_queued;
+  }
+private:
+  struct flush_scope {
+    queued_signal& signal;
+    flush_scope(queued_signal& context) : signal(context) {
+      signal.m_flushing = true;
+    }
+    ~flush_scope() {
+      signal.m_flushing = false;
+      // events queued after a slot threw stay queued, so only rewind once everything is gone
+      if (!signal.m_head) signal.m_arena.reset();
+    }
+  };
+  struct event_guard {
+    event* value;
+    ~event_guard() { value->~event(); }
+  };
+
+  void push(event* e) {
+    if (m_tail) m_tail->next = e;
+    else m_head = e;
+    m_tail = e;
+    m_queued++;
+  }
+  event* pop() {
+    auto e = m_head;
+    m_head = e->next;
+    if (!m_head) m_tail = nullptr;
+    m_queued--;
+    return e;
+  }
+  template <std::size_t... I>
+  [[gnu::always_inline]]
+  inline void dispatch(event& e, detail::index_sequence<I...>) {
+    // the event is thrown away afterwards so value arguments can be moved out of it
+    this->emit(std::forward<Args>(std::get<I>(e.args))...);
+  }
+  void swap_queue(queued_signal& other) {
+    using std::swap;
+    if (m_arena.can_swap(other.m_arena)) {
+      m_arena.swap(other.m_arena);
+      swap(m_head, other.m_head);
+      swap(m_tail, other.m_tail);
+      swap(m_queued, other.m_queued);
+      return;
+    }
+    // each arena has to stay with its own allocator, move the events across instead
+    auto ours = detach();
+    auto theirs = other.detach();
+    adopt(theirs);
+    other.adopt(ours);
+  }
+  event* detach() {
+    auto head = m_head;
+    m_head = m_tail = nullptr;
+    m_queued = 0;
+    return head;
+  }
+  // moves a detached list of events into this signal's arena, destroying the originals
+  void adopt(event* head) {
+    while (head) {
+      auto next = head->next;
+      event_guard guard { head };
+      auto e = ::new (m_arena.allocate(sizeof(event), alignof(event))) event(std::move(*head));
+      e->next = nullptr;
+      push(e);
+      head = next;
+    }
+  }
+
+  // queued events are allocated with the signal's allocator
+  detail::basic_bump_arena<allocator_type> m_arena { 1024, this->get_allocator() };
+  event* m_head = nullptr;
+  event* m_tail = nullptr;
+  size_type m_queued = 0;
+  bool m_flushing = false;
+};
+
+#if defined(SLIMSIG_HAS_PMR) && SLIMSIG_HAS_PMR
+namespace pmr {
+  // queued_signal whose slots and queued events come from a std::pmr::memory_resource
+  template <class Handler, class SignalTraits = signal_traits<Handler>>
+  using queued_signal = slimsig::queued_signal<Handler, SignalTraits, std::pmr::polymorphic_allocator<std::function<Handler>>>;
+}
+#endif
+
+}
+
+#endif
@@ -0,0 +1,189 @@
+//
+//  slab_allocator.h
+//  slimsig
+//
+//  Size class allocator that packs the slot lists of many small signals into shared pages
+//
+
+#ifndef slimsig_slab_allocator_h
+#define slimsig_slab_allocator_h
+
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <new>
+#include <type_traits>
+#include <vector>
+#include "slimsig.h"
+
+namespace slimsig {
+
+/**
+ *  Pages carved into blocks of 16, 32, ... 1024 bytes, one size class per page
+ *
+ *  A signal with a slot or two asks for a handful of tiny blocks (the slots, their liveness bits,
+ *  maybe a callable too big to store inline) and every doubling of its slot list asks for the next
+ *  size up. From the heap each of those is a separate allocation with its own header and slack;
+ *  from a slab_pool they're rounded up to a size class and handed out of pages shared with every
+ *  other signal using the pool, so sibling signals end up next to each other.
+ *
+ *  Freed blocks go on their class's free list and are reused by the next allocation of that class,
+ *  pages are only returned when the pool is destroyed. Bigger or over-aligned requests go straight
+ *  to operator new, the aligned one for over-aligned types. A pool isn't thread safe: give each
+ *  thread its own, or keep one global pool for signals that are only touched from one thread.
+ *  It has to outlive everything allocated from it.
+ */
+class slab_pool {
+public:
+  using size_type = std::size_t;
+  static constexpr size_type min_block = 16;
+  static constexpr size_type max_block = 1024;
+  static constexpr size_type page_size = 16 * 1024;
+
+  slab_pool() : m_free(), m_cursor(), m_end(), m_in_use(0) {};
+  slab_pool(const slab_pool&) = delete;
+  slab_pool& operator=(const slab_pool&) = delete;
+  ~slab_pool() {
+    assert(m_in_use == 0 && "a slab_pool was destroyed before everything allocated from it");
+    for (auto page : m_pages) ::operator delete(page);
+  }
+
+  void* allocate(size_type bytes, size_type alignment)
+  {
+    if (!pooled(bytes, alignment)) return allocate_unpooled(bytes, alignment);
+    auto index = size_class(bytes);
+    m_in_use++;
+    if (auto block = m_free[index]) {
+      m_free[index] = block->next;
+      return block;
+    }
+    auto size = min_block << index;
+    if (m_cursor[index] == m_end[index]) {
+      auto page = static_cast<unsigned char*>(::operator new(page_size));
+      m_pages.push_back(page);
+      m_cursor[index] = page;
+      m_end[index] = page + page_size / size * size;
+    }
+    auto block = m_cursor[index];
+    m_cursor[index] += size;
+    return block;
+  }
+  void deallocate(void* p, size_type bytes, size_type alignment)
+  {
+    if (!pooled(bytes, alignment)) return deallocate_unpooled(p, alignment);
+    auto index = size_class(bytes);
+    m_in_use--;
+    m_free[index] = ::new (p) free_block { m_free[index] };
+  }
+
+  // blocks handed out and not given back yet
+  size_type blocks_in_use() const { return m_in_use; }
+  size_type pages() const { return m_pages.size(); }
+  size_type reserved_bytes() const { return m_pages.size() * page_size; }
+private:
+  static constexpr size_type class_count = 7;
+  static_assert(min_block << (class_count - 1) == max_block, "a size class per power of two");
+  struct free_block {
+    free_block* next;
+  };
+
+  // pages come from operator new so blocks are aligned to their size, up to alignof(max_align_t)
+  static bool pooled(size_type bytes, size_type alignment)
+  {
+    return bytes <= max_block && alignment <= alignof(std::max_align_t) && alignment <= min_block;
+  }
+  static bool over_aligned(size_type alignment)
+  {
+    return alignment > alignof(std::max_align_t);
+  }
+  static void* allocate_unpooled(size_type bytes, size_type alignment)
+  {
+    if (!over_aligned(alignment)) return ::operator new(bytes);
+#if defined(__cpp_aligned_new)
+    return ::operator new(bytes, std::align_val_t(alignment));
+#else
+    // room to align the block and remember where the allocation started, just before it
+    auto raw = static_cast<unsigned char*>(::operator new(bytes + alignment + sizeof(void*)));
+    auto address = reinterpret_cast<std::uintptr_t>(raw + sizeof(void*));
+    auto block = raw + sizeof(void*) + (alignment - address % alignment) % alignment;
+    reinterpret_cast<void**>(block)[-1] = raw;
+    return block;
+#endif
+  }
+  static void deallocate_unpooled(void* p, size_type alignment)
+  {
+    if (!over_aligned(alignment)) return ::operator delete(p);
+#if defined(__cpp_aligned_new)
+    ::operator delete(p, std::align_val_t(alignment));
+#else
+    ::operator delete(static_cast<void**>(p)[-1]);
+#endif
+  }
+  static size_type size_class(size_type bytes)
+  {
+    size_type index = 0;
+    while ((min_block << index) < bytes) index++;
+    return index;
+  }
+
+  free_block* m_free[class_count];
+  unsigned char* m_cursor[class_count];
+  unsigned char* m_end[class_count];
+  std::vector<unsigned char*> m_pages;
+  size_type m_in_use;
+};
+
+/**
+ *  Allocator drawing from a slab_pool, pass the pool to the signal: slab_signal<void(int)> s { &pool };
+ *
+ *  Copies and rebinds share the pool and only compare equal when they do, so signals on different
+ *  pools swap their slots one by one rather than trading storage.
+ */
+template <class T>
+class slab_allocator {
+public:
+  using value_type = T;
+  using propagate_on_container_copy_assignment = std::false_type;
+  using propagate_on_container_move_assignment = std::false_type;
+  using propagate_on_container_swap = std::false_type;
+  template <class U>
+  struct rebind { using other = slab_allocator<U>; };
+
+  slab_allocator(slab_pool* pool) : m_pool(pool) {};
+  template <class U>
+  slab_allocator(const slab_allocator<U>& other) : m_pool(other.m_pool) {};
+
+  T* allocate(std::size_t n)
+  {
+    return static_cast<T*>(m_pool->allocate(n * sizeof(T), alignof(T)));
+  }
+  void deallocate(T* p, std::size_t n)
+  {
+    m_pool->deallocate(p, n * sizeof(T), alignof(T));
+  }
+  slab_pool* pool() const { return m_pool; }
+
+  template <class U>
+  bool operator==(const slab_allocator<U>& other) const { return m_pool == other.m_pool; }
+  template <class U>
+  bool operator!=(const slab_allocator<U>& other) const { return m_pool != other.m_pool; }
+private:
+  template <class U>
+  friend class slab_allocator;
+  slab_pool* m_pool;
+};
+
+// slab signals give their slot list back to the pool once it's mostly empty, so disconnect_all()
+// outside of an emit returns every block it held, see shrink_below
+template <class SignalTraits>
+struct slab_signal_traits : SignalTraits {
+  using shrink_policy = shrink_below<4>;
+};
+// a signal whose slot list, liveness bits and oversized callables all come from a slab_pool
+template <class Handler, class SignalTraits = signal_traits<Handler>>
+using slab_signal = signal<Handler, slab_signal_traits<SignalTraits>, slab_allocator<std::function<Handler>>>;
+
+}
+
+#endif
@@ -39,31 +39,50 @@
  * While still being light-weight it still supports:
  * - connections/scoped_connections
  * - connection.disconnect()/connection.connected() can be called after the signal stops existing 
- *    There's a small overhead because of the use of a shared_ptr for each slot, however, my average use-case
- *    Involves adding 1-2 slots per signal so the overhead is neglible, especially if you use a custom allocator such as boost:pool
+ *    Connections are a generational handle into a process wide table, so checking or disconnecting one is O(1)
+ *    and connecting a slot doesn't allocate anything besides the slot itself
  *
- *  To keep it simple I left out support for slots that return values, though it shouldn't be too hard to implement.
- *  I've also left thread safety as something to be handled by higher level libraries
- *  Much in the spirit of other STL containers. My reasoning is that even with thread safety sort of baked in
- *  The user would still be responsible making sure slots don't do anything funny if they are executed on different threads
- *  All the mechanics for this would complicate the library and really not solve much of anything while also slowing down 
- *  the library for applications where signals/slots are only used from a single thread
- * 
- *  Plus it makes things like adding slots to multiple signals really slow because you have to lock each and every time
- *  You'd be better off using your own syncronization methods to setup all your singals at once and releasing your lock after
- *  you're done
+ *  Slots that return values are supported through Boost::Signals2 style combiners (see combiners.h).
+ *  Signals are single threaded by default, much in the spirit of other STL containers: there's no locking
+ *  and nothing slows down applications that only use signals from one thread.
+ *  Traits with thread_policy = concurrent give a signal that any number of threads can emit while others
+ *  connect and disconnect (see detail/concurrent_signal_base.h). Even then the user is still responsible
+ *  for making sure slots don't do anything funny when they're executed on different threads
  */
 #ifndef slimsignals_h
 #define slimsignals_h
 
 #include "detail/signal_base.h"
+#include "detail/concurrent_signal_base.h"
+
+// C++17 standard libraries with <memory_resource> get slimsig::pmr aliases
+#if !defined(SLIMSIG_HAS_PMR) && __cplusplus >= 201703L && defined(__has_include)
+#if __has_include(<memory_resource>)
+#define SLIMSIG_HAS_PMR 1
+#endif
+#endif
+#if defined(SLIMSIG_HAS_PMR) && SLIMSIG_HAS_PMR
+#include <memory_resource>
+#endif
 
 namespace slimsig {
+  namespace detail {
+    template <class SignalTraits, class Allocator, class Handler, class ThreadPolicy = typename SignalTraits::thread_policy>
+    struct select_signal_base {
+      using type = signal_base<SignalTraits, Allocator, Handler>;
+    };
+    template <class SignalTraits, class Allocator, class Handler>
+    struct select_signal_base<SignalTraits, Allocator, Handler, concurrent> {
+      using type = concurrent_signal_base<SignalTraits, Allocator, Handler>;
+    };
+  }
   template <class Handler, class SignalTraits = signal_traits<Handler>, class Allocator = std::allocator<std::function<Handler>>>
-  class signal : private signal_base<SignalTraits, Allocator, Handler> {
+  class signal : private detail::select_signal_base<SignalTraits, Allocator, Handler>::type {
   public:
-    using base = signal_base<SignalTraits, Allocator, Handler>;
+    using base = typename detail::select_signal_base<SignalTraits, Allocator, Handler>::type;
     using typename base::return_type;
+    using typename base::combiner_type;
+    using typename base::result_type;
     using typename base::callback;
     using typename base::allocator_type;
     using typename base::slot;
@@ -79,9 +98,14 @@ namespace slimsig {
     // default constructor
     signal() : signal(allocator_type()) {};
     using base::emit;
+    using base::emit_with;
+    using base::emit_batch;
+    using base::emit_parallel;
+    using base::emit_parallel_on;
     using base::connect;
     using base::connect_once;
     using base::connect_extended;
+    using base::connect_weak;
     using base::disconnect_all;
     using base::slot_count;
     using base::get_allocator;
@@ -92,13 +116,43 @@ namespace slimsig {
     using base::get_depth;
     using base::is_running;
     using base::remaining_slots;
-
+    using base::memory_usage;
+    using base::stats;
+    using base::set_name;
+  private:
+    // relays reach the signal_base of the signal they re-emit
+    friend base;
   };
   template <
     class Handler,
     class SignalTraits = signal_traits<Handler>,
     class Allocator = std::allocator<std::function<Handler>>
   > using signal_t = signal<Handler, SignalTraits, Allocator>;
+
+  // SignalTraits with room for N slots inside the signal
+  template <class SignalTraits, std::size_t N>
+  struct small_signal_traits : SignalTraits {
+    static constexpr std::size_t inline_slots = N;
+  };
+  // a signal that keeps up to N slots inline and only allocates once it has more than that
+  // connect, disconnect and emit behave exactly like signal, including from inside slots
+  template <
+    class Handler,
+    std::size_t N,
+    class SignalTraits = signal_traits<Handler>,
+    class Allocator = std::allocator<std::function<Handler>>
+  > using small_signal = signal<Handler, small_signal_traits<SignalTraits, N>, Allocator>;
+
+#if defined(SLIMSIG_HAS_PMR) && SLIMSIG_HAS_PMR
+  // signals whose slots, oversized callables and bookkeeping all come from a std::pmr::memory_resource,
+  // pass one to the constructor: slimsig::pmr::signal<void(int)> signal { &arena };
+  namespace pmr {
+    template <class Handler, class SignalTraits = signal_traits<Handler>>
+    using signal = slimsig::signal<Handler, SignalTraits, std::pmr::polymorphic_allocator<std::function<Handler>>>;
+    template <class Handler, std::size_t N, class SignalTraits = signal_traits<Handler>>
+    using small_signal = slimsig::small_signal<Handler, N, SignalTraits, std::pmr::polymorphic_allocator<std::function<Handler>>>;
+  }
+#endif
   
 }
 #endif
@@ -0,0 +1,207 @@
+//
+//  static_signal.h
+//  slimsig
+//
+//  A signal whose slots are fixed at compile time
+//
+
+#ifndef slimsig_static_signal_h
+#define slimsig_static_signal_h
+
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <cstddef>
+#include "slimsig.h"
+#include "detail/apply.h"
+#include "detail/slot_call_iterator.h"
+
+namespace slimsig {
+
+template <class Handler, class... Slots>
+class static_signal;
+
+namespace detail {
+  template <class T>
+  struct always_false : std::false_type {};
+  // keeps a forwarding constructor from hiding the copy and move constructors
+  template <class Self, class... T>
+  struct is_self : std::false_type {};
+  template <class Self, class T>
+  struct is_self<Self, T> : std::is_same<Self, typename std::decay<T>::type> {};
+
+  // slot_call_iterator's view of a static_signal, combiners are the only thing that call slots
+  // by index so they're the only place a static_signal calls through a function pointer
+  template <class Tuple, class R, class... Args>
+  class static_slot_list {
+    template <std::size_t I>
+    static R call(Tuple& slots, Args&... args) {
+      return static_cast<R>(std::get<I>(slots)(args...));
+    }
+    using call_type = R (*)(Tuple&, Args&...);
+    template <std::size_t... I>
+    static const call_type* table(index_sequence<I...>) {
+      static const call_type calls[] = { &call<I>..., nullptr };
+      return calls;
+    }
+  public:
+    using size_type = std::size_t;
+    static_slot_list(Tuple& slots) : m_slots(slots) {};
+    size_type size() const { return std::tuple_size<Tuple>::value; }
+    bool connected(size_type) const { return true; }
+    R invoke(size_type index, Args&... args) const {
+      return table(make_index_sequence<std::tuple_size<Tuple>::value>{})[index](m_slots, args...);
+    }
+  private:
+    Tuple& m_slots;
+  };
+}
+
+/**
+ *  Calls a fixed set of slots, known at compile time, in order
+ *
+ *  Each slot is stored by value in a tuple and emit expands to one direct call per slot, so the
+ *  compiler can inline all of them: no type erasure, no slot vector and no bookkeeping for slots
+ *  connected or disconnected while emitting (there can't be any). The emitting side of the API
+ *  matches slimsig::signal so code that only emits can switch between the two. Slots can't be
+ *  connected or disconnected; trying to is a compile error.
+ *
+ *  Slots receive the arguments the same way signal passes them: as lvalues, except the last
+ *  slot, which gets them forwarded. Use make_static_signal to deduce the slot types from lambdas.
+ */
+template <class R, class... Args, class... Slots>
+class static_signal<R(Args...), Slots...> {
+  using slot_tuple = std::tuple<Slots...>;
+  using slot_list = detail::static_slot_list<slot_tuple, R, Args...>;
+  using slot_call_iterator = detail::slot_call_iterator<slot_list, R, Args...>;
+public:
+  using return_type = R;
+  using combiner_type = last_value<R>;
+  using result_type = typename combiner_type::result_type;
+  using size_type = std::size_t;
+  static constexpr auto arity = sizeof...(Args);
+  template <std::size_t N>
+  struct argument
+  {
+    static_assert(N < arity, "error: invalid parameter index.");
+    using type = typename std::tuple_element<N,std::tuple<Args...>>::type;
+  };
+
+  constexpr static_signal() : m_slots() {};
+  template <class... T, class = typename std::enable_if<
+    sizeof...(T) == sizeof...(Slots) && sizeof...(T) != 0 && !detail::is_self<static_signal, T...>::value>::type>
+  constexpr explicit static_signal(T&&... slots) : m_slots(std::forward<T>(slots)...) {};
+
+  [[gnu::always_inline]]
+  inline result_type emit(Args... args) {
+    return emit_impl(std::integral_constant<bool, sizeof...(Slots) == 0>{},
+                     detail::make_index_sequence<sizeof...(Slots) == 0 ? 0 : sizeof...(Slots) - 1>{}, args...);
+  }
+  [[gnu::always_inline]]
+  inline result_type operator()(Args... args) {
+    return emit(args...);
+  }
+
+  // emit, combining the slot results with the given combiner
+  template <class Combiner>
+  typename std::decay<Combiner>::type::result_type emit_with(Combiner&& combiner, Args... args) {
+    using state_type = detail::slot_call_state<slot_list, R, Args...>;
+    slot_list slots { m_slots };
+    state_type state { slots, args... };
+    return combiner(slot_call_iterator { state, 0, sizeof...(Slots) }, slot_call_iterator { state, sizeof...(Slots), sizeof...(Slots) });
+  }
+
+  // emits once per std::tuple<Args...> in [first, last), see signal_base::emit_batch
+  template <class Iterator>
+  void emit_batch(Iterator first, Iterator last, batch_order order = batch_order::event_major) {
+    using sequence = detail::make_index_sequence<sizeof...(Slots)>;
+    if (order == batch_order::event_major) {
+      for (; first != last; ++first) detail::apply_lvalues(call_all { *this }, *first);
+    } else {
+      batch_slot_major(first, last, sequence{});
+    }
+  }
+
+  // the slot at position I, in the order the slots were given
+  template <std::size_t I>
+  typename std::tuple_element<I, slot_tuple>::type& get() {
+    return std::get<I>(m_slots);
+  }
+  template <std::size_t I>
+  const typename std::tuple_element<I, slot_tuple>::type& get() const {
+    return std::get<I>(m_slots);
+  }
+
+  constexpr size_type slot_count() const {
+    return sizeof...(Slots);
+  }
+  constexpr bool empty() const {
+    return sizeof...(Slots) == 0;
+  }
+  constexpr size_type max_size() const {
+    return sizeof...(Slots);
+  }
+
+  template <class F>
+  void connect(F&&) {
+    static_assert(detail::always_false<F>::value, "static_signal slots are fixed at compile time, use slimsig::signal to connect slots");
+  }
+  template <class F>
+  void connect_once(F&&) {
+    static_assert(detail::always_false<F>::value, "static_signal slots are fixed at compile time, use slimsig::signal to connect slots");
+  }
+private:
+  struct call_all {
+    static_signal& signal;
+    template <class... T>
+    [[gnu::always_inline]]
+    inline void operator()(T&... args) const {
+      signal.call_each(detail::make_index_sequence<sizeof...(Slots)>{}, args...);
+    }
+  };
+
+  template <std::size_t... I, class... T>
+  [[gnu::always_inline]]
+  inline void call_each(detail::index_sequence<I...>, T&... args) {
+    using expand = int[];
+    (void)expand { 0, (void(std::get<I>(m_slots)(args...)), 0)... };
+  }
+
+  template <class Iterator, std::size_t... I>
+  void batch_slot_major(Iterator first, Iterator last, detail::index_sequence<I...>) {
+    using expand = int[];
+    (void)expand { 0, (batch_one<I>(first, last), 0)... };
+  }
+  template <std::size_t I, class Iterator>
+  void batch_one(Iterator first, Iterator last) {
+    for (; first != last; ++first) {
+      detail::apply_lvalues([this] (Args&... args) { std::get<I>(m_slots)(args...); }, *first);
+    }
+  }
+
+  template <std::size_t... I>
+  [[gnu::always_inline]]
+  inline result_type emit_impl(std::true_type, detail::index_sequence<I...>, Args&...) {
+    return detail::default_value<R>();
+  }
+  // every slot but the last gets lvalues, its result (if any) is thrown away like last_value does
+  template <std::size_t... I>
+  [[gnu::always_inline]]
+  inline result_type emit_impl(std::false_type, detail::index_sequence<I...> rest, Args&... args) {
+    call_each(rest, args...);
+    return static_cast<R>(std::get<sizeof...(Slots) - 1>(m_slots)(std::forward<Args>(args)...));
+  }
+
+  slot_tuple m_slots;
+};
+
+// builds a static_signal from callables, usually lambdas: make_static_signal<void(int)>([] (int) {...}, ...)
+template <class Handler, class... Slots>
+constexpr static_signal<Handler, typename std::decay<Slots>::type...> make_static_signal(Slots&&... slots)
+{
+  return static_signal<Handler, typename std::decay<Slots>::type...>(std::forward<Slots>(slots)...);
+}
+
+}
+
+#endif
@@ -0,0 +1,181 @@
+//
+//  thread_pool.h
+//  slimsig
+//
+//  Work stealing thread pool used by emit_parallel
+//
+
+#ifndef slimsig_thread_pool_h
+#define slimsig_thread_pool_h
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <algorithm>
+#include <cstddef>
+
+namespace slimsig {
+
+/**
+ *  Fixed set of worker threads, each with its own task deque
+ *
+ *  parallel_for spreads its tasks over the deques and then helps run them on the calling thread
+ *  until every task has finished, so a pool with no workers still works (serially) and a task
+ *  that calls parallel_for itself never deadlocks. Workers pop from the back of their own deque
+ *  and steal from the front of everyone else's when they run dry.
+ */
+class work_stealing_pool {
+public:
+  explicit work_stealing_pool(unsigned workers) : m_queues(), m_threads(), m_queued(0), m_stop(false), m_next_queue(0)
+  {
+    for (unsigned i = 0; i < std::max(workers, 1u); i++) m_queues.emplace_back(new queue());
+    for (unsigned i = 0; i < workers; i++) m_threads.emplace_back([this, i] { work(i); });
+  }
+  work_stealing_pool(const work_stealing_pool&) = delete;
+  work_stealing_pool& operator=(const work_stealing_pool&) = delete;
+  ~work_stealing_pool()
+  {
+    {
+      std::lock_guard<std::mutex> guard(m_sleep_lock);
+      m_stop = true;
+    }
+    m_wake.notify_all();
+    for (auto& thread : m_threads) thread.join();
+  }
+
+  // one worker per core, the thread calling parallel_for makes up the last one
+  static work_stealing_pool& shared()
+  {
+    static work_stealing_pool pool(std::max(std::thread::hardware_concurrency(), 1u) - 1);
+    return pool;
+  }
+  unsigned size() const { return unsigned(m_threads.size()); }
+
+  // calls fn(index) for every index in [0, count) and returns once they've all finished
+  // the first exception thrown by fn is rethrown here after the rest have run
+  template <class F>
+  void parallel_for(std::size_t count, const F& fn)
+  {
+    if (count == 0) return;
+    if (count == 1 || m_threads.empty()) {
+      for (std::size_t index = 0; index != count; index++) fn(index);
+      return;
+    }
+    job current { &invoke<F>, &fn, count };
+    auto first = m_next_queue.fetch_add(1, std::memory_order_relaxed);
+    m_queued.fetch_add(count, std::memory_order_release);
+    for (std::size_t q = 0; q != m_queues.size(); q++) {
+      auto& target = *m_queues[(first + q) % m_queues.size()];
+      std::lock_guard<std::mutex> guard(target.lock);
+      for (auto index = q; index < count; index += m_queues.size()) target.tasks.push_back({ &current, index });
+    }
+    {
+      std::lock_guard<std::mutex> guard(m_sleep_lock);
+    }
+    m_wake.notify_all();
+    auto home = local_queue();
+    while (current.remaining.load(std::memory_order_acquire) != 0) {
+      if (!run_one(home)) std::this_thread::yield();
+    }
+    if (current.error) std::rethrow_exception(current.error);
+  }
+private:
+  struct job {
+    job(void (*r)(const void*, std::size_t), const void* f, std::size_t count) : run(r), fn(f), remaining(count), error() {};
+    void (*run)(const void*, std::size_t);
+    const void* fn;
+    std::atomic<std::size_t> remaining;
+    std::mutex error_lock;
+    std::exception_ptr error;
+  };
+  struct task {
+    job* owner;
+    std::size_t index;
+  };
+  struct queue {
+    std::mutex lock;
+    std::deque<task> tasks;
+  };
+
+  template <class F>
+  static void invoke(const void* fn, std::size_t index) { (*static_cast<const F*>(fn))(index); }
+
+  // workers run their own queue first, anyone else starts wherever their last parallel_for did
+  std::size_t local_queue()
+  {
+    auto index = worker_index();
+    return (index != std::size_t(-1) ? index : m_next_queue.load(std::memory_order_relaxed)) % m_queues.size();
+  }
+  static std::size_t& worker_index()
+  {
+    static thread_local std::size_t index = std::size_t(-1);
+    return index;
+  }
+
+  bool run_one(std::size_t home)
+  {
+    task next;
+    if (!pop(home, next)) return false;
+    try {
+      next.owner->run(next.owner->fn, next.index);
+    } catch (...) {
+      std::lock_guard<std::mutex> guard(next.owner->error_lock);
+      if (!next.owner->error) next.owner->error = std::current_exception();
+    }
+    // the job lives on the stack of its parallel_for, it can be gone as soon as this drops to zero
+    next.owner->remaining.fetch_sub(1, std::memory_order_acq_rel);
+    return true;
+  }
+  bool pop(std::size_t home, task& out)
+  {
+    if (m_queued.load(std::memory_order_acquire) == 0) return false;
+    {
+      auto& own = *m_queues[home];
+      std::lock_guard<std::mutex> guard(own.lock);
+      if (!own.tasks.empty()) {
+        out = own.tasks.back();
+        own.tasks.pop_back();
+        m_queued.fetch_sub(1, std::memory_order_relaxed);
+        return true;
+      }
+    }
+    for (std::size_t i = 1; i < m_queues.size(); i++) {
+      auto& victim = *m_queues[(home + i) % m_queues.size()];
+      std::lock_guard<std::mutex> guard(victim.lock);
+      if (!victim.tasks.empty()) {
+        out = victim.tasks.front();
+        victim.tasks.pop_front();
+        m_queued.fetch_sub(1, std::memory_order_relaxed);
+        return true;
+      }
+    }
+    return false;
+  }
+  void work(std::size_t index)
+  {
+    worker_index() = index;
+    for (;;) {
+      if (run_one(index)) continue;
+      std::unique_lock<std::mutex> lock(m_sleep_lock);
+      m_wake.wait(lock, [&] { return m_stop || m_queued.load(std::memory_order_acquire) != 0; });
+      if (m_stop) return;
+    }
+  }
+
+  std::vector<std::unique_ptr<queue>> m_queues;
+  std::vector<std::thread> m_threads;
+  std::atomic<std::size_t> m_queued;
+  std::mutex m_sleep_lock;
+  std::condition_variable m_wake;
+  bool m_stop;
+  std::atomic<std::size_t> m_next_queue;
+};
+
+}
+
+#endif
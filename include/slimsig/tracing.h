@@ -0,0 +1,275 @@
+//
+//  tracing.h
+//  slimsig
+//
+//  Per-slot latency tracing, compiled in with SLIMSIG_TRACING and switched on at runtime
+//
+
+#ifndef slimsig_tracing_h
+#define slimsig_tracing_h
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <thread>
+#include <vector>
+#include <algorithm>
+#include <unordered_map>
+#include <iomanip>
+
+#include "detail/instrumentation.h"
+
+// define SLIMSIG_TRACING=1 to compile the hooks in, tracer::enable() then turns them on
+// with the hooks compiled in but disabled every emit and slot call costs one predictable branch
+#ifndef SLIMSIG_TRACING
+#define SLIMSIG_TRACING 0
+#endif
+
+// events kept per thread, the oldest are overwritten once a thread's ring is full
+#ifndef SLIMSIG_TRACE_BUFFER_SIZE
+#define SLIMSIG_TRACE_BUFFER_SIZE 16384
+#endif
+
+namespace slimsig {
+
+// one emit or slot call, timestamps are steady_clock nanoseconds
+struct trace_event {
+  // slot value for events that cover a whole emit
+  static constexpr std::uint64_t emit = ~std::uint64_t(0);
+  const void* signal;
+  std::uint64_t slot;
+  unsigned depth;
+  std::uint64_t start;
+  std::uint64_t end;
+};
+
+namespace detail {
+
+/**
+ *  Fixed size ring of trace events written by a single thread
+ *
+ *  The owning thread is the only writer so recording is a plain store followed by a release of
+ *  the head, no locks and no read-modify-write. Readers must only look at a ring while tracing is
+ *  disabled and no traced emit is running, see tracer::events().
+ */
+class trace_ring {
+public:
+  static constexpr std::size_t capacity = SLIMSIG_TRACE_BUFFER_SIZE;
+  static_assert((capacity & (capacity - 1)) == 0, "SLIMSIG_TRACE_BUFFER_SIZE must be a power of two");
+
+  explicit trace_ring(std::size_t thread) : m_events(new trace_event[capacity]), m_head(0), m_thread(thread) {};
+
+  [[gnu::always_inline]]
+  inline void push(const trace_event& event) {
+    auto head = m_head.load(std::memory_order_relaxed);
+    m_events[head & (capacity - 1)] = event;
+    m_head.store(head + 1, std::memory_order_release);
+  }
+  template <class F>
+  void for_each(F&& fn) const {
+    auto head = m_head.load(std::memory_order_acquire);
+    for (auto i = head - std::min(head, std::uint64_t(capacity)); i < head; i++) fn(m_events[i & (capacity - 1)]);
+  }
+  void clear() { m_head.store(0, std::memory_order_relaxed); }
+  std::size_t thread() const { return m_thread; }
+private:
+  std::unique_ptr<trace_event[]> m_events;
+  std::atomic<std::uint64_t> m_head;
+  std::size_t m_thread;
+};
+
+// what the current thread is emitting, slot events are attributed to it
+struct trace_context {
+  const void* signal = nullptr;
+  unsigned depth = 0;
+};
+
+class trace_thread;
+
+}
+
+/**
+ *  Process wide switch and exporter for slot tracing
+ *
+ *  Every thread that records an event gets its own ring, rings outlive their threads so events
+ *  from pool workers can still be exported after the pool is gone.
+ */
+class tracer {
+public:
+  // true when the hooks are compiled in and tracing is switched on
+  [[gnu::always_inline]]
+  static inline bool enabled() {
+    return SLIMSIG_TRACING && flag().load(std::memory_order_relaxed);
+  }
+  static void enable() { flag().store(true, std::memory_order_relaxed); }
+  static void disable() { flag().store(false, std::memory_order_relaxed); }
+
+  // drops every recorded event, along with the rings of threads that have exited
+  static void clear() {
+    auto& s = state();
+    std::lock_guard<std::mutex> guard(s.lock);
+    s.rings.erase(std::remove_if(s.rings.begin(), s.rings.end(), [] (const std::shared_ptr<detail::trace_ring>& ring) {
+      return ring.use_count() == 1;
+    }), s.rings.end());
+    for (auto& ring : s.rings) ring->clear();
+  }
+
+  // copies every recorded event along with the id of the thread that recorded it
+  // only call this while tracing is disabled and no traced emit is in flight
+  static std::vector<std::pair<std::size_t, trace_event>> events() {
+    std::vector<std::pair<std::size_t, trace_event>> events;
+    auto& s = state();
+    std::lock_guard<std::mutex> guard(s.lock);
+    for (auto& ring : s.rings) {
+      ring->for_each([&] (const trace_event& event) { events.emplace_back(ring->thread(), event); });
+    }
+    return events;
+  }
+
+  // writes the recorded events in Chrome's trace_event JSON format, which chrome://tracing and
+  // Perfetto both load. Emits are named after the signal when it is instrumented and has a name
+  static void write_chrome_trace(std::ostream& out) {
+    std::unordered_map<const void*, std::string> names;
+    for (auto& stats : signal_registry::snapshot()) {
+      if (!stats.name.empty()) names[stats.signal] = stats.name;
+    }
+    auto flags = out.flags();
+    auto precision = out.precision();
+    out << "{\"displayTimeUnit\": \"ns\", \"traceEvents\": [";
+    bool first = true;
+    for (auto& entry : events()) {
+      auto& event = entry.second;
+      auto name = names.find(event.signal);
+      out << (first ? "\n" : ",\n") << "{\"ph\": \"X\", \"cat\": \"slimsig\", \"pid\": 1, \"tid\": " << entry.first
+          << std::fixed << std::setprecision(3)
+          << ", \"ts\": " << double(event.start) / 1000 << ", \"dur\": " << double(event.end - event.start) / 1000
+          << ", \"name\": \"";
+      if (event.slot == trace_event::emit) {
+        out << "emit";
+        if (name != names.end()) out << " " << escape(name->second);
+      } else {
+        out << "slot " << event.slot;
+      }
+      out << "\", \"args\": {\"signal\": \"" << event.signal << "\", \"depth\": " << event.depth;
+      if (event.slot != trace_event::emit) out << ", \"slot\": " << event.slot;
+      out << "}}";
+      first = false;
+    }
+    out << "\n]}\n";
+    out.flags(flags);
+    out.precision(precision);
+  }
+private:
+  friend class detail::trace_thread;
+  static std::string escape(const std::string& s) {
+    std::string out;
+    for (auto c : s) {
+      if (c == '"' || c == '\\') out += '\\';
+      out += c;
+    }
+    return out;
+  }
+  struct registry {
+    std::mutex lock;
+    std::vector<std::shared_ptr<detail::trace_ring>> rings;
+    std::size_t next_thread = 1;
+  };
+  static std::atomic<bool>& flag() {
+    static std::atomic<bool> enabled { false };
+    return enabled;
+  }
+  // never destroyed so threads exiting after main can still drop their rings
+  static registry& state() {
+    static registry* instance = new registry();
+    return *instance;
+  }
+};
+
+namespace detail {
+
+// the current thread's ring and emit context, the ring is registered on first use
+class trace_thread {
+public:
+  static trace_thread& current() {
+    static thread_local trace_thread instance;
+    return instance;
+  }
+  trace_ring& ring() {
+    if (!m_ring) {
+      auto& s = tracer::state();
+      std::lock_guard<std::mutex> guard(s.lock);
+      m_ring = std::make_shared<trace_ring>(s.next_thread++);
+      s.rings.push_back(m_ring);
+    }
+    return *m_ring;
+  }
+  trace_context context;
+private:
+  std::shared_ptr<trace_ring> m_ring;
+};
+
+inline std::uint64_t trace_now() {
+  return std::uint64_t(std::chrono::duration_cast<std::chrono::nanoseconds>(
+    std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+// records a slot call against whatever the thread is emitting, only built once tracing is on
+class slot_trace {
+public:
+  slot_trace(std::uint64_t slot) : m_slot(slot), m_start(trace_now()) {};
+  slot_trace(const slot_trace&) = delete;
+  ~slot_trace() {
+    auto& thread = trace_thread::current();
+    thread.ring().push({ thread.context.signal, m_slot, thread.context.depth, m_start, trace_now() });
+  }
+private:
+  std::uint64_t m_slot;
+  std::uint64_t m_start;
+};
+
+// calls fn(args...) and records how long it took
+template <class F, class... Args>
+auto traced_call(std::uint64_t slot, const F& fn, Args&&... args) -> decltype(fn(std::forward<Args>(args)...))
+{
+  slot_trace trace { slot };
+  return fn(std::forward<Args>(args)...);
+}
+
+/**
+ *  Marks the current thread as emitting a signal for as long as it lives and, if tracing was on
+ *  when it was created, records the whole emit as one event
+ */
+class emit_trace {
+public:
+  emit_trace(const void* signal, unsigned depth) : m_active(tracer::enabled()) {
+    if (m_active) {
+      auto& context = trace_thread::current().context;
+      m_previous = context;
+      context.signal = signal;
+      context.depth = depth;
+      m_start = trace_now();
+    }
+  }
+  emit_trace(const emit_trace&) = delete;
+  ~emit_trace() {
+    if (m_active) {
+      auto& thread = trace_thread::current();
+      thread.ring().push({ thread.context.signal, trace_event::emit, thread.context.depth, m_start, trace_now() });
+      thread.context = m_previous;
+    }
+  }
+private:
+  bool m_active;
+  trace_context m_previous;
+  std::uint64_t m_start;
+};
+
+}
+}
+
+#endif
@@ -5,6 +5,9 @@
     "type": "executable",
     "include_dirs": ["deps/bandit", "test"],
     "includes": ["slimsig.gypi"],
+    "conditions": [
+      ["OS != 'win'", {"cflags": ["-pthread"], "ldflags": ["-pthread"]}]
+    ],
     "sources": [
     "test/test.cpp",
     # for ease of development
@@ -12,14 +15,39 @@
     "include/slimsig/tracked_connect.h",
     "include/slimsig/detail/signal_base.h",
     "include/slimsig/connection.h",
+    "include/slimsig/connection_set.h",
     "include/slimsig/detail/slot.h",
+    "include/slimsig/detail/inplace_function.h",
+    "include/slimsig/detail/slot_call_iterator.h",
+    "include/slimsig/detail/apply.h",
+    "include/slimsig/detail/slot_storage.h",
+    "include/slimsig/detail/concurrent_signal_base.h",
+    "include/slimsig/detail/epoch.h",
+    "include/slimsig/detail/handle_table.h",
+    "include/slimsig/combiners.h",
+    "include/slimsig/queued_signal.h",
+    "include/slimsig/keyed_signal.h",
+    "include/slimsig/mailbox_signal.h",
+    "include/slimsig/compact_signal.h",
+    "include/slimsig/slab_allocator.h",
+    "include/slimsig/static_signal.h",
+    "include/slimsig/thread_pool.h",
+    "include/slimsig/tracing.h",
+    "include/slimsig/detail/bump_arena.h",
+    "include/slimsig/detail/inline_allocator.h",
+    "include/slimsig/detail/mailbox_ring.h",
+    "include/slimsig/detail/instrumentation.h",
     "slimsig.gyp", "slimsig.gypi", "common.gypi"]
   }, {
     "target_name": "benchmark",
     "type": "executable",
+    "default_configuration": "Release",
     "include_dirs": ["benchmark", "include"],
     "includes": ["slimsig.gypi"],
-    "sources": ["benchmark/benchmark.cpp"]
+    "conditions": [
+      ["OS != 'win'", {"cflags": ["-pthread"], "ldflags": ["-pthread"]}]
+    ],
+    "sources": ["benchmark/benchmark.cpp", "benchmark/harness.h"]
   }, {
     "target_name": "benchmark-boost",
     "type": "executable",
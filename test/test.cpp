@@ -1,7 +1,18 @@
+#define SLIMSIG_TRACING 1
 #include <iostream>
+#include <sstream>
 #include <array>
+#include <atomic>
+#include <thread>
 #include <bandit/bandit.h>
 #include <slimsig/slimsig.h>
+#include <slimsig/queued_signal.h>
+#include <slimsig/static_signal.h>
+#include <slimsig/keyed_signal.h>
+#include <slimsig/mailbox_signal.h>
+#include <slimsig/compact_signal.h>
+#include <slimsig/slab_allocator.h>
+#include <slimsig/connection_set.h>
 
 using namespace bandit;
 namespace ss = slimsig;
@@ -17,6 +28,141 @@ struct class_test {
   void bound_slot() { bound_slot_triggered = true; }
   void operator() () { functor_slot_triggered = true; }
 };
+struct accumulator {
+  int total = 0;
+  void add(int value) { total += value; }
+  int scaled(int factor) const { return total * factor; }
+};
+template <class Handler>
+using connection_t = typename signal_t<Handler>::connection;
+struct max_traits : ss::signal_traits<int()> {
+  using combiner_type = ss::maximum<int>;
+};
+struct split_traits : ss::signal_traits<void(int)> {
+  static constexpr ss::slot_layout layout = ss::slot_layout::split;
+};
+struct concurrent_traits : ss::signal_traits<void(int)> {
+  using thread_policy = ss::concurrent;
+};
+struct instrumented_traits : ss::signal_traits<void()> {
+  static constexpr bool instrumented = true;
+};
+struct ratio_traits : ss::signal_traits<void(int)> {
+  using compaction_policy = ss::compact_ratio<50>;
+  static constexpr bool instrumented = true;
+};
+template <ss::slot_layout Layout>
+struct incremental_traits : ss::signal_traits<void(int)> {
+  using compaction_policy = ss::compact_incremental<4>;
+  static constexpr ss::slot_layout layout = Layout;
+  static constexpr bool instrumented = true;
+};
+// leaves tombstones in place until every slot is gone
+struct lazy_traits : ss::signal_traits<void(int)> {
+  using compaction_policy = ss::compact_ratio<100>;
+};
+template <ss::slot_layout Layout, std::size_t InlineSlots = 0>
+struct shrink_traits : ss::signal_traits<void(int)> {
+  using shrink_policy = ss::shrink_below<4>;
+  static constexpr ss::slot_layout layout = Layout;
+  static constexpr std::size_t inline_slots = InlineSlots;
+};
+struct large_slot_traits : ss::signal_traits<void()> {
+  static constexpr std::size_t slot_storage_size = 64;
+};
+// stateful allocator, copies share one tally and only compare equal to allocators sharing it
+struct allocation_tally {
+  std::size_t allocations = 0;
+  std::ptrdiff_t outstanding = 0;
+};
+template <class T>
+struct counting_allocator {
+  using value_type = T;
+  counting_allocator(allocation_tally* t) : tally(t) {};
+  template <class U>
+  counting_allocator(const counting_allocator<U>& other) : tally(other.tally) {};
+  T* allocate(std::size_t n) {
+    tally->allocations++;
+    tally->outstanding++;
+    return std::allocator<T>().allocate(n);
+  }
+  void deallocate(T* p, std::size_t n) {
+    tally->outstanding--;
+    std::allocator<T>().deallocate(p, n);
+  }
+  template <class U>
+  bool operator==(const counting_allocator<U>& other) const { return tally == other.tally; }
+  template <class U>
+  bool operator!=(const counting_allocator<U>& other) const { return tally != other.tally; }
+  allocation_tally* tally;
+};
+template <class Handler, class Traits = ss::signal_traits<Handler>>
+using counted_signal = ss::signal<Handler, Traits, counting_allocator<std::function<Handler>>>;
+
+// disconnects every other slot of 20 and checks that emits stay correct while a
+// compact_incremental<4> pass slides the survivors down over a few emits
+template <ss::slot_layout Layout>
+void check_incremental_compaction()
+{
+  ss::signal<void(int), incremental_traits<Layout>> signal;
+  std::vector<ss::connection<typename decltype(signal)::base>> connections;
+  std::vector<int> calls;
+  for (int i = 0; i < 20; i++) connections.push_back(signal.connect([&calls, i] (int) { calls.push_back(i); }));
+  for (int i = 0; i < 20; i += 2) connections[i].disconnect();
+  std::vector<int> expected;
+  for (int i = 1; i < 20; i += 2) expected.push_back(i);
+  for (int emit = 0; emit < 4; emit++) {
+    calls.clear();
+    signal.emit(0);
+    AssertThat(calls, Equals(expected));
+    AssertThat(signal.stats().compactions, Equals(unsigned(emit + 1)));
+  }
+  // 4 slots per emit, so the 20 slot pass isn't done yet and the gap is still there
+  AssertThat(signal.stats().tombstones > 0, Equals(true));
+  // slots that have moved can still be disconnected through their connections
+  connections[3].disconnect();
+  connections[19].disconnect();
+  expected.erase(std::remove(expected.begin(), expected.end(), 3), expected.end());
+  expected.pop_back();
+  for (int emit = 0; emit < 10; emit++) {
+    calls.clear();
+    signal.emit(0);
+    AssertThat(calls, Equals(expected));
+  }
+  AssertThat(signal.stats().tombstones, Equals(0u));
+  AssertThat(signal.slot_count(), Equals(8u));
+  AssertThat(connections[5].connected(), Equals(true));
+  connections[5].disconnect();
+  AssertThat(signal.slot_count(), Equals(7u));
+}
+
+// connects 1024 slots, disconnects most of them while idle and checks the slot list only gives
+// back capacity once fewer than a quarter are left, with every remaining connection still working
+template <ss::slot_layout Layout>
+void check_shrinking()
+{
+  ss::signal<void(int), shrink_traits<Layout>> signal;
+  std::vector<ss::connection<typename decltype(signal)::base>> connections;
+  int calls = 0;
+  for (int i = 0; i < 1024; i++) connections.push_back(signal.connect([&] (int) { calls++; }));
+  auto full = signal.memory_usage();
+  for (int i = 0; i < 700; i++) connections[i].disconnect();
+  signal.emit(0);
+  AssertThat(calls, Equals(324));
+  AssertThat(signal.memory_usage(), Equals(full));
+  for (int i = 700; i < 1000; i++) connections[i].disconnect();
+  signal.emit(0);
+  AssertThat(calls, Equals(348));
+  auto shrunk = signal.memory_usage();
+  AssertThat(shrunk < full / 8, Equals(true));
+  connections[1010].disconnect();
+  signal.emit(0);
+  AssertThat(calls, Equals(371));
+  AssertThat(signal.memory_usage(), Equals(shrunk));
+  AssertThat(connections[1020].connected(), Equals(true));
+  signal.disconnect_all();
+  AssertThat(signal.memory_usage(), Equals(sizeof(signal)));
+}
 
 go_bandit([]
 {
@@ -48,6 +194,24 @@ go_bandit([]
       signal.emit();
       AssertThat(obj.bound_slot_triggered, Equals(true));
     });
+    it("should trigger (object, member function) slots", [&]
+    {
+      class_test obj;
+      signal.connect(&obj, &class_test::bound_slot);
+      signal.emit();
+      AssertThat(obj.bound_slot_triggered, Equals(true));
+    });
+    it("should disconnect weak member function slots once their object is gone", [&]
+    {
+      auto obj = std::make_shared<class_test>();
+      auto connection = signal.connect_weak(obj, &class_test::bound_slot);
+      signal.emit();
+      AssertThat(obj->bound_slot_triggered, Equals(true));
+      AssertThat(obj.use_count(), Equals(1));
+      obj.reset();
+      signal.emit();
+      AssertThat(connection.connected(), Equals(false));
+    });
     it("should trigger functor slots", [&]
     {
       class_test obj;
@@ -117,6 +281,69 @@ go_bandit([]
         AssertThat(signal.slot_count(), Equals(2u));
       });
     });
+    describe("#connect(std::shared_ptr<signal>)", [&]{
+      it("should relay emits depth first, however deep the chain", [&] {
+        using relay_type = slimsig::signal<void(int)>;
+        std::vector<int> calls;
+        auto root = std::make_shared<relay_type>();
+        auto middle = std::make_shared<relay_type>();
+        auto leaf = std::make_shared<relay_type>();
+        root->connect([&] (int x) { calls.push_back(x); });
+        root->connect(middle);
+        root->connect([&] (int x) { calls.push_back(x * 100); });
+        middle->connect([&] (int x) { calls.push_back(x * 10); });
+        middle->connect(leaf);
+        leaf->connect([&] (int x) { calls.push_back(-x); });
+        root->emit(1);
+        AssertThat(calls, Equals(std::vector<int> { 1, 10, -1, 100 }));
+        
+        // past the hops walked without recursion relays fall back to nested emits
+        std::vector<std::shared_ptr<relay_type>> chain;
+        for (int i = 0; i < 40; i++) chain.push_back(std::make_shared<relay_type>());
+        for (int i = 0; i + 1 < 40; i++) chain[i]->connect(chain[i + 1]);
+        int reached = 0;
+        chain.back()->connect([&] (int x) { reached += x; });
+        chain.front()->emit(2);
+        AssertThat(reached, Equals(2));
+      });
+      it("should drop relays to signals that are gone and keep relayed signals alive while they run", [&] {
+        using relay_type = slimsig::signal<void(int)>;
+        auto root = std::make_shared<relay_type>();
+        auto relayed = std::make_shared<relay_type>();
+        unsigned count = 0;
+        root->connect(relayed);
+        relayed->connect([&] (int) { relayed.reset(); count++; });
+        relayed->connect([&] (int) { count++; });
+        root->emit(0);
+        AssertThat(count, Equals(2u));
+        AssertThat(root->slot_count(), Equals(1u));
+        root->emit(0);
+        AssertThat(count, Equals(2u));
+        AssertThat(root->slot_count(), Equals(0u));
+      });
+      it("should let relayed slots connect and disconnect while the chain emits", [&] {
+        using relay_type = slimsig::signal<void(int)>;
+        auto root = std::make_shared<relay_type>();
+        auto relayed = std::make_shared<relay_type>();
+        unsigned count = 0;
+        auto conn = root->connect(relayed);
+        relayed->connect_once([&] (int) {
+          count++;
+          relayed->connect([&] (int) { count += 10; });
+          conn.disconnect();
+        });
+        root->emit(0);
+        AssertThat(count, Equals(1u));
+        AssertThat(relayed->slot_count(), Equals(1u));
+        AssertThat(root->empty(), Equals(true));
+        
+        slimsig::signal<int(int)> summed;
+        auto doubled = std::make_shared<slimsig::signal<int(int)>>();
+        doubled->connect([] (int x) { return x * 2; });
+        summed.connect(doubled);
+        AssertThat(summed.emit_with(slimsig::sum<int>{}, 4), Equals(8));
+      });
+    });
     describe("#connect_once()", [&]{
       it("it should fire once", [&] {
         unsigned count = 0;
@@ -129,6 +356,54 @@ go_bandit([]
         AssertThat(count, Equals(1u));
         
       });
+      it("should be disconnected before it runs, even by emits from inside it", [&] {
+        unsigned count = 0;
+        bool connected = true;
+        slimsig::signal<void()>::connection conn;
+        conn = signal.connect_once([&] {
+          count++;
+          connected = conn.connected();
+          signal.emit();
+        });
+        signal.emit();
+        AssertThat(count, Equals(1u));
+        AssertThat(connected, Equals(false));
+        AssertThat(signal.slot_count(), Equals(0u));
+      });
+      it("should not be disconnected twice when a slot before it calls disconnect_all", [&] {
+        unsigned count = 0;
+        signal.connect([&] { signal.disconnect_all(); });
+        signal.connect_once([&] { count++; });
+        signal.emit();
+        signal.emit();
+        AssertThat(count, Equals(1u));
+        AssertThat(signal.slot_count(), Equals(0u));
+        // the handle table is shared, a handle released twice would be handed out twice
+        slimsig::signal<void()> other;
+        auto first = other.connect([]{});
+        auto second = other.connect([]{});
+        first.disconnect();
+        AssertThat(second.connected(), Equals(true));
+        AssertThat(other.slot_count(), Equals(1u));
+        second.disconnect();
+        AssertThat(other.slot_count(), Equals(0u));
+      });
+      it("should fire once through combiners, batches and the split layout", [&] {
+        slimsig::signal<int(int)> summed;
+        summed.connect_once([] (int x) { return x; });
+        summed.connect([] (int x) { return x * 10; });
+        AssertThat(summed.emit_with(slimsig::sum<int>{}, 1), Equals(11));
+        AssertThat(summed.emit_with(slimsig::sum<int>{}, 1), Equals(10));
+        
+        slimsig::signal<void(int), split_traits> split;
+        std::vector<int> seen;
+        split.connect_once([&] (int x) { seen.push_back(x); });
+        split.connect([&] (int x) { seen.push_back(-x); });
+        const std::vector<std::tuple<int>> events { std::make_tuple(1), std::make_tuple(2) };
+        split.emit_batch(events.begin(), events.end());
+        AssertThat(seen, Equals(std::vector<int> { 1, -1, -2 }));
+        AssertThat(split.slot_count(), Equals(1u));
+      });
     });
     describe("#disconnect_all()", [&]
     {
@@ -205,7 +480,1378 @@ go_bandit([]
         AssertThat(signal.slot_count(), Equals(1));
       });
     });
-    
+    describe("#emit_batch()", [&] {
+      ss::signal<void(int)> batched;
+      std::vector<std::tuple<int>> events { std::make_tuple(1), std::make_tuple(2), std::make_tuple(3) };
+      before_each([&] { batched = ss::signal<void(int)>{}; });
+      it("should call slots in event order", [&]
+      {
+        std::vector<int> calls;
+        batched.connect([&] (int i) { calls.push_back(i); });
+        batched.connect([&] (int i) { calls.push_back(i * 10); });
+        batched.emit_batch(events.begin(), events.end());
+        AssertThat(calls, Equals(std::vector<int>{ 1, 10, 2, 20, 3, 30 }));
+      });
+      it("should call slots in slot order", [&]
+      {
+        std::vector<int> calls;
+        batched.connect([&] (int i) { calls.push_back(i); });
+        batched.connect([&] (int i) { calls.push_back(i * 10); });
+        batched.emit_batch(events.begin(), events.end(), ss::batch_order::slot_major);
+        AssertThat(calls, Equals(std::vector<int>{ 1, 2, 3, 10, 20, 30 }));
+      });
+      it("should see slots connected and disconnected by earlier events", [&]
+      {
+        std::vector<int> calls;
+        connection_t<void(int)> conn;
+        conn = batched.connect([&] (int i) {
+          calls.push_back(i);
+          conn.disconnect();
+          batched.connect([&] (int i) { calls.push_back(i * 10); });
+        });
+        batched.emit_batch(events.begin(), events.end());
+        AssertThat(calls, Equals(std::vector<int>{ 1, 20, 30 }));
+        AssertThat(batched.slot_count(), Equals(1u));
+      });
+      it("should stop calling a slot disconnected in slot order", [&]
+      {
+        unsigned count = 0;
+        connection_t<void(int)> conn;
+        conn = batched.connect([&] (int i) { count++; if (i == 2) conn.disconnect(); });
+        batched.connect([&] (int) { count++; });
+        batched.emit_batch(events.begin(), events.end(), ss::batch_order::slot_major);
+        AssertThat(count, Equals(5u));
+        AssertThat(batched.slot_count(), Equals(1u));
+      });
+    });
+  });
+  describe("combiners", [] {
+    it("should return the last value by default", [&]
+    {
+      ss::signal<int(int)> signal;
+      AssertThat(signal.emit(1), Equals(0));
+      signal.connect([] (int i) { return i + 1; });
+      signal.connect([] (int i) { return i + 2; });
+      AssertThat(signal.emit(1), Equals(3));
+    });
+    it("should support combiners from signal_traits", [&]
+    {
+      ss::signal<int(), max_traits> signal;
+      signal.connect([] { return 4; });
+      signal.connect([] { return 9; });
+      signal.connect([] { return 2; });
+      AssertThat(signal.emit(), Equals(9));
+    });
+    it("should support per-call combiners", [&]
+    {
+      ss::signal<int(int)> signal;
+      signal.connect([] (int i) { return i; });
+      signal.connect([] (int i) { return i * 2; });
+      AssertThat(signal.emit_with(ss::sum<int>{}, 3), Equals(9));
+      AssertThat(signal.emit_with(ss::minimum<int>{}, 3), Equals(3));
+    });
+    it("should not call slots after the combiner stops", [&]
+    {
+      ss::signal<const char*()> signal;
+      unsigned calls = 0;
+      signal.connect([&] () -> const char* { calls++; return nullptr; });
+      signal.connect([&] () -> const char* { calls++; return "found"; });
+      signal.connect([&] () -> const char* { calls++; return "too late"; });
+      AssertThat(std::string(signal.emit_with(ss::first_non_null<const char*>{})), Equals(std::string("found")));
+      AssertThat(calls, Equals(2u));
+    });
+    it("should skip slots disconnected while combining", [&]
+    {
+      ss::signal<int()> signal;
+      connection_t<int()> second;
+      signal.connect([&] { second.disconnect(); return 1; });
+      second = signal.connect([] { return 2; });
+      AssertThat(signal.emit_with(ss::sum<int>{}), Equals(1));
+    });
+  });
+  describe("split slot layout", [] {
+    using signal_type = ss::signal<void(int), split_traits>;
+    signal_type signal;
+    before_each([&] { signal = signal_type{}; });
+    it("should only call connected slots", [&]
+    {
+      std::vector<int> fired(150);
+      std::vector<signal_type::connection> connections;
+      for (int i = 0; i < 150; i++) {
+        connections.push_back(signal.connect([&fired, i] (int n) { fired[i] += n; }));
+      }
+      for (int i = 0; i < 150; i += 3) connections[i].disconnect();
+      signal.emit(1);
+      for (int i = 0; i < 150; i++) AssertThat(fired[i], Equals(i % 3 == 0 ? 0 : 1));
+      AssertThat(signal.slot_count(), Equals(100u));
+      AssertThat(connections[1].connected(), Equals(true));
+      AssertThat(connections[3].connected(), Equals(false));
+    });
+    it("should skip slots disconnected during emit", [&]
+    {
+      unsigned count = 0;
+      signal_type::connection second;
+      signal.connect([&] (int) { count++; second.disconnect(); });
+      second = signal.connect([&] (int) { count++; });
+      signal.emit(0);
+      AssertThat(count, Equals(1u));
+      AssertThat(signal.slot_count(), Equals(1u));
+    });
+    it("should be re-entrant", [&]
+    {
+      unsigned count = 0;
+      signal.connect([&] (int) {
+        ++count;
+        if (count == 1) {
+          signal.connect_once([&] (int) { ++count; });
+          for (int i = 0; i < 8; i++) signal.connect([] (int) {});
+          signal.emit(0);
+        }
+      });
+      signal.emit(0);
+      AssertThat(count, Equals(3u));
+      AssertThat(signal.slot_count(), Equals(9u));
+    });
+    it("should remove all slots while iterating", [&]
+    {
+      unsigned count = 0;
+      auto conn = signal.connect([&] (int) { count++; signal.disconnect_all(); });
+      signal.connect([&] (int) { count++; });
+      signal.emit(0);
+      AssertThat(count, Equals(2u));
+      AssertThat(conn.connected(), Equals(false));
+      AssertThat(signal.empty(), Equals(true));
+    });
+  });
+  describe("concurrent signal", [] {
+    using signal_type = ss::signal<void(int), concurrent_traits>;
+    signal_type signal;
+    before_each([&] { signal = signal_type{}; });
+    it("should call member functions, weakly held ones until their object is gone", [&]
+    {
+      accumulator strong;
+      auto weak = std::make_shared<accumulator>();
+      signal.connect(&strong, &accumulator::add);
+      auto connection = signal.connect_weak(weak, &accumulator::add);
+      signal.emit(2);
+      AssertThat(strong.total, Equals(2));
+      AssertThat(weak->total, Equals(2));
+      weak.reset();
+      signal.emit(3);
+      AssertThat(strong.total, Equals(5));
+      AssertThat(connection.connected(), Equals(false));
+      AssertThat(signal.slot_count(), Equals(1u));
+    });
+    it("should be re-entrant", [&]
+    {
+      unsigned count = 0;
+      signal.connect([&] (int) {
+        ++count;
+        if (count == 1) {
+          signal.connect_once([&] (int) { ++count; });
+          signal.emit(0);
+        }
+      });
+      signal.emit(0);
+      AssertThat(count, Equals(3u));
+      AssertThat(signal.slot_count(), Equals(1u));
+    });
+    it("should free a slot disconnected during emit once the emit finishes", [&]
+    {
+      auto state = std::make_shared<int>(0);
+      std::weak_ptr<int> watch = state;
+      signal_type::connection connection;
+      connection = signal.connect([&connection, state] (int value) {
+        *state += value;
+        connection.disconnect();
+      });
+      state.reset();
+      signal.emit(1);
+      // nothing connects or disconnects afterwards, the emit itself has to let go of the callable
+      AssertThat(watch.expired(), Equals(true));
+      AssertThat(signal.slot_count(), Equals(0u));
+    });
+    it("should destroy a disconnected callable after releasing the writer lock", [&]
+    {
+      unsigned count = 0;
+      // the callable's destructor disconnects a sibling slot from the same signal
+      auto sibling = std::make_shared<ss::scoped_connection<signal_type::connection>>(signal.connect([&] (int) { count++; }));
+      auto connection = signal.connect([sibling] (int) {});
+      sibling.reset();
+      connection.disconnect();
+      signal.emit(0);
+      AssertThat(count, Equals(0u));
+      AssertThat(signal.slot_count(), Equals(0u));
+    });
+    it("should skip slots disconnected during emit", [&]
+    {
+      unsigned count = 0;
+      signal_type::connection second;
+      signal.connect([&] (int) { count++; second.disconnect(); });
+      second = signal.connect([&] (int) { count++; });
+      signal.emit(0);
+      AssertThat(count, Equals(1u));
+      AssertThat(second.connected(), Equals(false));
+      AssertThat(signal.slot_count(), Equals(1u));
+    });
+    it("should remove all slots while iterating", [&]
+    {
+      unsigned count = 0;
+      auto conn = signal.connect([&] (int) { count++; signal.disconnect_all(); });
+      signal.connect([&] (int) { count++; });
+      signal.emit(0);
+      AssertThat(count, Equals(2u));
+      AssertThat(conn.connected(), Equals(false));
+      AssertThat(signal.empty(), Equals(true));
+    });
+    it("should emit from many threads while slots are rewired", [&]
+    {
+      std::atomic<long> total { 0 };
+      std::atomic<bool> done { false };
+      signal.connect([&] (int n) { total += n; });
+      std::vector<std::thread> emitters;
+      for (int t = 0; t < 4; t++) {
+        emitters.emplace_back([&] {
+          for (int i = 0; i < 20000; i++) signal.emit(1);
+        });
+      }
+      std::thread rewire([&] {
+        while (!done) {
+          auto conn = signal.connect([&] (int) {});
+          conn.disconnect();
+        }
+      });
+      for (auto& thread : emitters) thread.join();
+      done = true;
+      rewire.join();
+      AssertThat(total.load(), Equals(80000l));
+      AssertThat(signal.slot_count(), Equals(1u));
+    });
+    it("should fire once slots exactly once across threads", [&]
+    {
+      std::atomic<int> fired { 0 };
+      signal.connect_once([&] (int) { fired++; });
+      std::vector<std::thread> emitters;
+      for (int t = 0; t < 4; t++) {
+        emitters.emplace_back([&] { for (int i = 0; i < 100; i++) signal.emit(0); });
+      }
+      for (auto& thread : emitters) thread.join();
+      AssertThat(fired.load(), Equals(1));
+      AssertThat(signal.empty(), Equals(true));
+    });
+    it("should emit batches in either order", [&]
+    {
+      const std::vector<std::tuple<int>> events { std::make_tuple(1), std::make_tuple(2) };
+      std::vector<int> calls;
+      signal.connect([&] (int i) { calls.push_back(i); });
+      signal.connect([&] (int i) { calls.push_back(-i); });
+      signal.emit_batch(events.begin(), events.end());
+      signal.emit_batch(events.begin(), events.end(), ss::batch_order::slot_major);
+      AssertThat(calls, Equals(std::vector<int>{ 1, -1, 2, -2, 1, 2, -1, -2 }));
+    });
+  });
+  describe("parallel emit", [] {
+    using signal_type = ss::signal<void(int)>;
+    signal_type signal;
+    // sized explicitly so slots really run on several threads whatever the machine
+    ss::work_stealing_pool pool(3);
+    before_each([&] { signal = signal_type{}; });
+    it("should call every slot exactly once", [&]
+    {
+      std::vector<std::atomic<int>> calls(2000);
+      for (auto& count : calls) {
+        count = 0;
+        signal.connect([&count] (int n) { count += n; });
+      }
+      signal.emit_parallel_on(pool, 1);
+      AssertThat(std::count_if(calls.begin(), calls.end(), [] (const std::atomic<int>& c) { return c == 1; }), Equals(2000));
+    });
+    it("should add slots connected by slots once every slot has run", [&]
+    {
+      std::atomic<int> calls { 0 };
+      for (int i = 0; i < 500; i++) {
+        signal.connect([&] (int) {
+          calls++;
+          signal.connect([&] (int) { calls++; });
+        });
+      }
+      signal.emit_parallel_on(pool, 0);
+      AssertThat(calls.load(), Equals(500));
+      AssertThat(signal.slot_count(), Equals(1000u));
+      calls = 0;
+      signal.emit(0);
+      AssertThat(calls.load(), Equals(1000));
+    });
+    it("should let slots disconnect themselves and each other", [&]
+    {
+      std::atomic<int> calls { 0 };
+      std::vector<connection_t<void(int)>> connections(500);
+      for (int i = 0; i < 500; i++) {
+        connections[i] = signal.connect([&, i] (int) {
+          calls++;
+          connections[i].disconnect();
+          connections[(i + 1) % 500].disconnect();
+        });
+      }
+      signal.emit_parallel_on(pool, 0);
+      AssertThat(calls.load(), IsGreaterThan(0));
+      AssertThat(signal.slot_count(), Equals(0u));
+      signal.emit_parallel_on(pool, 0);
+      AssertThat(signal.empty(), Equals(true));
+    });
+    it("should support disconnect_all from a slot", [&]
+    {
+      std::atomic<int> calls { 0 };
+      connection_t<void(int)> added;
+      for (int i = 0; i < 500; i++) signal.connect([&] (int) { calls++; });
+      signal.connect([&] (int) {
+        added = signal.connect([&] (int) { calls++; });
+        signal.disconnect_all();
+      });
+      signal.emit_parallel_on(pool, 0);
+      AssertThat(signal.slot_count(), Equals(0u));
+      AssertThat(added.connected(), Equals(false));
+      calls = 0;
+      signal.emit_parallel_on(pool, 0);
+      AssertThat(calls.load(), Equals(0));
+    });
+    it("should rethrow exceptions from slots", [&]
+    {
+      std::atomic<int> calls { 0 };
+      for (int i = 0; i < 100; i++) signal.connect([&] (int) { calls++; });
+      signal.connect([] (int) { throw std::runtime_error("slot failed"); });
+      bool thrown = false;
+      try {
+        signal.emit_parallel_on(pool, 0);
+      } catch (const std::runtime_error&) {
+        thrown = true;
+      }
+      AssertThat(thrown, Equals(true));
+      AssertThat(calls.load(), Equals(100));
+      AssertThat(signal.is_running(), Equals(false));
+    });
+    it("should work with concurrent signals", [&]
+    {
+      ss::signal<void(int), concurrent_traits> concurrent_signal;
+      std::atomic<int> calls { 0 };
+      for (int i = 0; i < 1000; i++) concurrent_signal.connect([&] (int n) { calls += n; });
+      concurrent_signal.emit_parallel(2);
+      AssertThat(calls.load(), Equals(2000));
+    });
+  });
+  describe("instrumentation", [] {
+    using signal_type = ss::signal<void(), instrumented_traits>;
+    it("should count emits, slot calls and depth", [&]
+    {
+      signal_type signal;
+      unsigned count = 0;
+      signal.connect([&] {
+        if (++count == 1) signal.emit();
+      });
+      signal.connect([]{});
+      signal.emit();
+      auto stats = signal.stats();
+      AssertThat(stats.emits, Equals(2u));
+      AssertThat(stats.slot_calls, Equals(4u));
+      AssertThat(stats.max_depth, Equals(2u));
+      AssertThat(stats.slots, Equals(2u));
+    });
+    it("should track tombstones and compactions", [&]
+    {
+      signal_type signal;
+      auto first = signal.connect([]{});
+      signal.connect([]{});
+      first.disconnect();
+      AssertThat(signal.stats().tombstones, Equals(1u));
+      signal.emit();
+      auto stats = signal.stats();
+      AssertThat(stats.compactions, Equals(1u));
+      AssertThat(stats.tombstones, Equals(0u));
+      AssertThat(stats.slots, Equals(1u));
+      AssertThat(stats.capacity >= 1, Equals(true));
+    });
+    it("should list live instrumented signals in the registry", [&]
+    {
+      auto find = [] (const void* signal) {
+        for (auto& stats : ss::signal_registry::snapshot()) {
+          if (stats.signal == signal) return stats.name;
+        }
+        return std::string("missing");
+      };
+      std::unique_ptr<signal_type> signal(new signal_type());
+      signal->set_name("frame");
+      auto address = static_cast<const void*>(signal.get());
+      AssertThat(find(address), Equals("frame"));
+      signal.reset();
+      AssertThat(find(address), Equals("missing"));
+    });
+    it("should report nothing for signals that aren't instrumented", [&]
+    {
+      ss::signal<void()> signal;
+      signal.connect([]{});
+      signal.emit();
+      AssertThat(signal.stats().emits, Equals(0u));
+    });
+  });
+  describe("tracing", [] {
+    using event_list = std::vector<ss::trace_event>;
+    auto recorded = [] {
+      event_list events;
+      for (auto& entry : ss::tracer::events()) events.push_back(entry.second);
+      return events;
+    };
+    before_each([&] {
+      ss::tracer::disable();
+      ss::tracer::clear();
+    });
+    after_each([&] {
+      ss::tracer::disable();
+      ss::tracer::clear();
+    });
+    it("should record nothing while disabled", [&]
+    {
+      signal_t<void()> signal;
+      signal.connect([]{});
+      signal.emit();
+      AssertThat(recorded().size(), Equals(0u));
+    });
+    it("should record every emit and slot call with its depth", [&]
+    {
+      signal_t<void(int)> signal;
+      signal.connect([&] (int depth) {
+        if (depth == 1) signal.emit(2);
+      });
+      auto second = signal.connect([] (int) {});
+      ss::tracer::enable();
+      signal.emit(1);
+      ss::tracer::disable();
+      auto events = recorded();
+      // slots finish before the emit that called them, the nested emit finishes first of all
+      AssertThat(events.size(), Equals(6u));
+      AssertThat(events[2].slot, Equals(ss::trace_event::emit));
+      AssertThat(events[2].depth, Equals(2u));
+      AssertThat(events[5].slot, Equals(ss::trace_event::emit));
+      AssertThat(events[5].depth, Equals(1u));
+      for (auto& event : events) {
+        AssertThat(event.signal, Equals(static_cast<const void*>(&signal)));
+        AssertThat(event.end >= event.start, Equals(true));
+      }
+      AssertThat(events[4].slot, Equals(events[1].slot));
+      AssertThat(events[4].depth, Equals(1u));
+      AssertThat(events[4].slot != events[3].slot, Equals(true));
+      AssertThat(events[5].start <= events[2].start && events[2].end <= events[5].end, Equals(true));
+      second.disconnect();
+    });
+    it("should trace slots of concurrent signals", [&]
+    {
+      ss::signal<void(int), concurrent_traits> signal;
+      signal.connect([] (int) {});
+      signal.connect([] (int) {});
+      ss::tracer::enable();
+      signal.emit(1);
+      ss::tracer::disable();
+      auto events = recorded();
+      AssertThat(events.size(), Equals(3u));
+      AssertThat(events[2].slot, Equals(ss::trace_event::emit));
+      AssertThat(events[0].slot != events[1].slot, Equals(true));
+    });
+    it("should export chrome trace events", [&]
+    {
+      ss::signal<void(), instrumented_traits> signal;
+      signal.set_name("frame");
+      signal.connect([]{});
+      ss::tracer::enable();
+      signal.emit();
+      ss::tracer::disable();
+      std::ostringstream out;
+      ss::tracer::write_chrome_trace(out);
+      auto json = out.str();
+      AssertThat(json.find("\"traceEvents\"") != std::string::npos, Equals(true));
+      AssertThat(json.find("\"name\": \"emit frame\"") != std::string::npos, Equals(true));
+      AssertThat(json.find("\"name\": \"slot ") != std::string::npos, Equals(true));
+      AssertThat(json.find("\"ph\": \"X\"") != std::string::npos, Equals(true));
+    });
+  });
+  describe("slot storage", [] {
+    using callback = ss::signal<void()>::callback;
+    it("should store small callables inline", [&]
+    {
+      int a = 0, b = 0;
+      callback fn = [&] { a++; b++; };
+      AssertThat(fn.stored_inline(), Equals(true));
+      fn();
+      AssertThat(a + b, Equals(2));
+    });
+    it("should fall back to the heap for large callables", [&]
+    {
+      std::array<char, 64> buffer{};
+      bool fired = false;
+      callback fn = [buffer, &fired] { fired = buffer[0] == 0; };
+      AssertThat(fn.stored_inline(), Equals(false));
+      ss::signal<void()> signal;
+      signal.connect(std::move(fn));
+      signal.emit();
+      AssertThat(fired, Equals(true));
+    });
+    it("should store function pointers and member function pairs inline", [&]
+    {
+      accumulator acc;
+      ss::signal<int(int)>::callback fn = ss::detail::member_slot<const accumulator, int (accumulator::*)(int) const> { &acc, &accumulator::scaled };
+      AssertThat(fn.stored_inline(), Equals(true));
+      callback pointer = &function_slot;
+      AssertThat(pointer.stored_inline(), Equals(true));
+      ss::signal<int(int)> signal;
+      signal.connect(&acc, &accumulator::scaled);
+      acc.total = 3;
+      AssertThat(signal.emit(2), Equals(6));
+    });
+    it("should respect the inline size from signal_traits", [&]
+    {
+      using signal_type = ss::signal<void(), large_slot_traits>;
+      std::array<char, 48> buffer{};
+      signal_type::callback fn = [buffer] {};
+      AssertThat(fn.stored_inline(), Equals(true));
+    });
+    it("should skip runs of disconnected slots", [&]
+    {
+      ss::signal<void(int), lazy_traits> signal;
+      std::vector<ss::connection<ss::signal<void(int), lazy_traits>::base>> connections;
+      std::vector<int> calls;
+      for (int i = 0; i < 200; i++) {
+        connections.push_back(signal.connect([&calls, &connections, i] (int value) {
+          calls.push_back(i);
+          // slots disconnected by a running slot are skipped by the same emit
+          if (i == 63 && value == 1) {
+            connections[64].disconnect();
+            connections[199].disconnect();
+          }
+        }));
+      }
+      std::vector<int> live { 0, 63, 64, 65, 130, 199 };
+      for (int i = 0; i < 200; i++) {
+        if (std::find(live.begin(), live.end(), i) == live.end()) connections[i].disconnect();
+      }
+      signal.emit(0);
+      AssertThat(calls, Equals(live));
+      calls.clear();
+      signal.emit(1);
+      AssertThat(calls, Equals(std::vector<int>({ 0, 63, 65, 130 })));
+      AssertThat(signal.slot_count(), Equals(4u));
+    });
+    it("should keep a running slot valid when the slot list grows", [&]
+    {
+      ss::signal<void()> signal;
+      std::string message = "still here";
+      std::string seen;
+      signal.connect([&signal, &seen, message] {
+        for (unsigned i = 0; i < 16; i++) signal.connect([]{});
+        seen = message;
+      });
+      signal.emit();
+      AssertThat(seen, Equals(message));
+      AssertThat(signal.slot_count(), Equals(17u));
+    });
+    it("should keep a re-entered slot valid when the slot list grows", [&]
+    {
+      ss::signal<void(int)> signal;
+      auto value = std::make_shared<int>(42);
+      // small enough to be stored inline, so growing would move it
+      signal.connect([&signal, value] (int depth) {
+        if (depth > 0) return;
+        signal.emit(1);
+        for (unsigned i = 0; i < 16; i++) signal.connect([] (int) {});
+        ++*value;
+      });
+      signal.emit(0);
+      AssertThat(*value, Equals(43));
+      AssertThat(signal.slot_count(), Equals(17u));
+    });
+    it("should keep a running slot's state when the slot list grows", [&]
+    {
+      ss::signal<void()> signal;
+      std::vector<int> counts;
+      int count = 0;
+      signal.connect([&signal, &counts, count] () mutable {
+        for (unsigned i = 0; i < 16; i++) signal.connect([]{});
+        counts.push_back(++count);
+      });
+      signal.emit();
+      signal.emit();
+      signal.emit();
+      AssertThat(counts, Equals(std::vector<int>({ 1, 2, 3 })));
+    });
+    it("should keep a running slot's state when the split slot list grows", [&]
+    {
+      ss::signal<void(int), split_traits> signal;
+      std::vector<int> counts;
+      int count = 0;
+      signal.connect([&signal, &counts, count] (int) mutable {
+        for (unsigned i = 0; i < 16; i++) signal.connect([] (int) {});
+        counts.push_back(++count);
+      });
+      signal.emit(0);
+      signal.emit(0);
+      signal.emit(0);
+      AssertThat(counts, Equals(std::vector<int>({ 1, 2, 3 })));
+    });
+  });
+  describe("compaction policy", [] {
+    it("should wait for the tombstone ratio before compacting", [&]
+    {
+      ss::signal<void(int), ratio_traits> signal;
+      std::vector<ss::connection<decltype(signal)::base>> connections;
+      int calls = 0;
+      for (int i = 0; i < 10; i++) connections.push_back(signal.connect([&] (int) { calls++; }));
+      for (int i = 0; i < 4; i++) connections[i].disconnect();
+      signal.emit(0);
+      AssertThat(calls, Equals(6));
+      AssertThat(signal.stats().tombstones, Equals(4u));
+      AssertThat(signal.stats().compactions, Equals(0u));
+      connections[4].disconnect();
+      signal.emit(0);
+      AssertThat(calls, Equals(11));
+      AssertThat(signal.stats().tombstones, Equals(0u));
+      AssertThat(signal.stats().compactions, Equals(1u));
+      connections[9].disconnect();
+      signal.emit(0);
+      AssertThat(calls, Equals(15));
+    });
+    it("should compact incrementally with the interleaved layout", [&]
+    {
+      check_incremental_compaction<ss::slot_layout::interleaved>();
+    });
+    it("should compact incrementally with the split layout", [&]
+    {
+      check_incremental_compaction<ss::slot_layout::split>();
+    });
+    it("should release slots disconnected mid-emit even when compaction waits", [&]
+    {
+      ss::signal<void(int), ratio_traits> signal;
+      auto captured = std::make_shared<int>(0);
+      std::vector<ss::connection<decltype(signal)::base>> connections;
+      for (int i = 0; i < 3; i++) connections.push_back(signal.connect([captured] (int) {}));
+      connections.push_back(signal.connect([&] (int) { connections[0].disconnect(); }));
+      signal.emit(0);
+      AssertThat(signal.stats().tombstones, Equals(1u));
+      AssertThat(captured.use_count(), Equals(3));
+    });
+  });
+  describe("shrink policy", [] {
+    it("should keep capacity by default", [&]
+    {
+      ss::signal<void(int)> signal;
+      for (int i = 0; i < 100; i++) signal.connect([] (int) {});
+      auto usage = signal.memory_usage();
+      AssertThat(usage > sizeof(signal) + 100 * sizeof(void*), Equals(true));
+      signal.disconnect_all();
+      AssertThat(signal.memory_usage(), Equals(usage));
+    });
+    it("should shrink with hysteresis with the interleaved layout", [&]
+    {
+      check_shrinking<ss::slot_layout::interleaved>();
+    });
+    it("should shrink with hysteresis with the split layout", [&]
+    {
+      check_shrinking<ss::slot_layout::split>();
+    });
+    it("should shrink back into inline slots", [&]
+    {
+      ss::signal<void(int), shrink_traits<ss::slot_layout::interleaved, 2>> signal;
+      int calls = 0;
+      for (int i = 0; i < 10; i++) signal.connect([&] (int) { calls++; });
+      AssertThat(signal.memory_usage() > sizeof(signal), Equals(true));
+      // disconnect_all from a slot leaves the slots to the end of the emit
+      signal.connect([&] (int) { signal.disconnect_all(); });
+      signal.emit(0);
+      AssertThat(calls, Equals(10));
+      AssertThat(signal.memory_usage(), Equals(sizeof(signal)));
+      signal.connect([&] (int) { calls++; });
+      signal.emit(0);
+      AssertThat(calls, Equals(11));
+      AssertThat(signal.memory_usage(), Equals(sizeof(signal)));
+    });
+    it("should count callables too big to store inline", [&]
+    {
+      ss::signal<void(int)> small, large;
+      std::array<char, 256> buffer{};
+      small.connect([] (int) {});
+      large.connect([buffer] (int) { (void)buffer; });
+      AssertThat(large.memory_usage() - small.memory_usage() >= sizeof(buffer), Equals(true));
+      ss::signal<void(int), concurrent_traits> concurrent;
+      auto empty = concurrent.memory_usage();
+      concurrent.connect([buffer] (int) { (void)buffer; });
+      AssertThat(concurrent.memory_usage() - empty >= sizeof(buffer), Equals(true));
+      ss::compact_signal<void(int)> compact;
+      AssertThat(compact.memory_usage(), Equals(sizeof(void*)));
+      compact.connect([buffer] (int) { (void)buffer; });
+      AssertThat(compact.memory_usage(), Equals(sizeof(void*) + large.memory_usage()));
+    });
+  });
+  describe("queued_signal", [] {
+    using signal_type = ss::queued_signal<void(std::string&)>;
+    signal_type signal;
+    before_each([&] { signal = signal_type{}; });
+    it("should not call slots until flushed", [&]
+    {
+      std::vector<std::string> seen;
+      signal.connect([&] (std::string& str) { seen.push_back(str); });
+      std::string first = "first", second = "second";
+      signal.emit_deferred(first);
+      signal.emit_deferred(second);
+      first = "changed";
+      AssertThat(seen.size(), Equals(0u));
+      AssertThat(signal.queued(), Equals(2u));
+      AssertThat(signal.flush(), Equals(2u));
+      AssertThat(seen, Equals(std::vector<std::string>{ "first", "second" }));
+      AssertThat(signal.queued(), Equals(0u));
+    });
+    it("should flush events queued while flushing in order", [&]
+    {
+      std::vector<std::string> seen;
+      signal.connect([&] (std::string& str) {
+        seen.push_back(str);
+        if (str == "a") {
+          std::string c = "c";
+          signal.emit_deferred(c);
+          AssertThat(signal.flush(), Equals(0u));
+        }
+      });
+      std::string a = "a", b = "b";
+      signal.emit_deferred(a);
+      signal.emit_deferred(b);
+      AssertThat(signal.flush(), Equals(3u));
+      AssertThat(seen, Equals(std::vector<std::string>{ "a", "b", "c" }));
+    });
+    it("should destroy discarded arguments", [&]
+    {
+      ss::queued_signal<void(std::shared_ptr<int>)> queued;
+      auto value = std::make_shared<int>(1);
+      queued.emit_deferred(value);
+      AssertThat(value.use_count(), Equals(2));
+      queued.discard();
+      AssertThat(value.use_count(), Equals(1));
+      AssertThat(queued.flush(), Equals(0u));
+    });
+    it("should reuse its arena after draining", [&]
+    {
+      ss::detail::bump_arena arena(64);
+      for (int i = 0; i < 100; i++) arena.allocate(sizeof(int), alignof(int));
+      arena.reset();
+      auto capacity = arena.capacity();
+      for (int round = 0; round < 3; round++) {
+        for (int i = 0; i < 100; i++) arena.allocate(sizeof(int), alignof(int));
+        arena.reset();
+      }
+      AssertThat(arena.capacity(), Equals(capacity));
+    });
+  });
+  describe("small_signal", [] {
+    using signal_type = ss::small_signal<void(int), 2>;
+    it("should spill past its inline slots", [&]
+    {
+      signal_type signal;
+      std::vector<int> calls;
+      std::vector<ss::connection<signal_type::base>> connections;
+      for (int i = 0; i < 5; i++) connections.push_back(signal.connect([&calls, i] (int) { calls.push_back(i); }));
+      connections[1].disconnect();
+      signal.emit(0);
+      AssertThat(calls, Equals(std::vector<int>({ 0, 2, 3, 4 })));
+      AssertThat(signal.slot_count(), Equals(4u));
+    });
+    it("should keep running slots alive when connecting from inside an emit", [&]
+    {
+      signal_type signal;
+      std::vector<int> calls;
+      // the inline buffer is full, so this connect spills while the slot sitting in it is running
+      signal.connect([&] (int value) {
+        std::string padding(64, 'x');
+        calls.push_back(value);
+        if (value == 1) {
+          signal.connect([&] (int v) { calls.push_back(v * 10); });
+          signal.connect([&] (int v) { calls.push_back(v * 100); });
+        }
+        calls.push_back(int(padding.size()));
+      });
+      signal.connect([&] (int value) { calls.push_back(-value); });
+      signal.emit(1);
+      AssertThat(calls, Equals(std::vector<int>({ 1, 64, -1 })));
+      calls.clear();
+      signal.emit(2);
+      AssertThat(calls, Equals(std::vector<int>({ 2, 64, -2, 20, 200 })));
+    });
+    it("should keep connections working when moved", [&]
+    {
+      signal_type first;
+      int total = 0;
+      auto connection = first.connect([&] (int value) { total += value; });
+      first.connect([&] (int value) { total += value * 10; });
+      signal_type second(std::move(first));
+      second.emit(1);
+      AssertThat(total, Equals(11));
+      AssertThat(first.slot_count(), Equals(0u));
+      connection.disconnect();
+      second.emit(1);
+      AssertThat(total, Equals(21));
+      signal_type third;
+      third.connect([&] (int value) { total += value * 100; });
+      third = std::move(second);
+      third.emit(1);
+      AssertThat(total, Equals(31));
+    });
+  });
+  describe("allocators", [] {
+    it("should allocate slots and large callables with the signal's allocator", [&]
+    {
+      allocation_tally tally;
+      {
+        counted_signal<void()> signal { &tally };
+        std::array<char, 64> buffer{};
+        int calls = 0;
+        // too big for the slot, so each lands in its own block next to the slots and their liveness bits
+        for (int i = 0; i < 3; i++) signal.connect([buffer, &calls] { calls += 1 + buffer[0]; });
+        AssertThat(tally.outstanding, Equals(5));
+        signal.connect_once([buffer, &calls] { calls += 10 + buffer[0]; });
+        signal.connect_extended([buffer, &calls] (counted_signal<void()>::connection&) { calls += 100 + buffer[0]; });
+        signal.emit();
+        signal.emit();
+        AssertThat(calls, Equals(3 * 2 + 10 + 100 * 2));
+      }
+      AssertThat(tally.allocations > 4, Equals(true));
+      AssertThat(tally.outstanding, Equals(0));
+    });
+    it("should allocate split and concurrent slots with the signal's allocator", [&]
+    {
+      allocation_tally split_tally, concurrent_tally;
+      {
+        counted_signal<void(int), split_traits> split { &split_tally };
+        counted_signal<void(int), concurrent_traits> concurrent { &concurrent_tally };
+        int total = 0;
+        auto first = split.connect([&] (int v) { total += v; });
+        concurrent.connect([&] (int v) { total += v * 10; });
+        auto second = concurrent.connect([&] (int v) { total += v * 100; });
+        AssertThat(split_tally.outstanding > 0, Equals(true));
+        AssertThat(concurrent_tally.outstanding > 0, Equals(true));
+        split.emit(1);
+        concurrent.emit(1);
+        first.disconnect();
+        second.disconnect();
+        split.emit(1);
+        concurrent.emit(1);
+        AssertThat(total, Equals(121));
+      }
+      AssertThat(split_tally.outstanding, Equals(0));
+      AssertThat(concurrent_tally.outstanding, Equals(0));
+    });
+    it("should swap signals whose allocators differ", [&]
+    {
+      allocation_tally left_tally, right_tally;
+      {
+        counted_signal<void(int)> left { &left_tally }, right { &right_tally };
+        counted_signal<void(int), concurrent_traits> concurrent_left { &left_tally }, concurrent_right { &right_tally };
+        std::array<char, 64> buffer{};
+        std::vector<int> calls;
+        auto a = left.connect([&, buffer] (int v) { calls.push_back(v + buffer[0]); });
+        left.connect([&] (int v) { calls.push_back(v * 2); });
+        right.connect([&] (int v) { calls.push_back(v * 3); });
+        concurrent_left.connect([&, buffer] (int v) { calls.push_back(v * 4 + buffer[0]); });
+        std::swap(left, right);
+        std::swap(concurrent_left, concurrent_right);
+        left.emit(1);
+        right.emit(1);
+        concurrent_left.emit(1);
+        concurrent_right.emit(1);
+        AssertThat(calls, Equals(std::vector<int>({ 3, 1, 2, 4 })));
+        a.disconnect();
+        calls.clear();
+        right.emit(1);
+        AssertThat(calls, Equals(std::vector<int>({ 2 })));
+      }
+      AssertThat(left_tally.outstanding, Equals(0));
+      AssertThat(right_tally.outstanding, Equals(0));
+    });
+    it("should queue events with the signal's allocator", [&]
+    {
+      allocation_tally tally;
+      {
+        ss::queued_signal<void(int), ss::signal_traits<void(int)>, counting_allocator<std::function<void(int)>>> signal { &tally };
+        int total = 0;
+        signal.connect([&] (int v) { total += v; });
+        auto before = tally.allocations;
+        for (int i = 0; i < 4; i++) signal.emit_deferred(i);
+        AssertThat(tally.allocations > before, Equals(true));
+        signal.flush();
+        AssertThat(total, Equals(6));
+      }
+      AssertThat(tally.outstanding, Equals(0));
+    });
+    it("should swap queued events between signals whose allocators differ", [&]
+    {
+      using queued_type = ss::queued_signal<void(int), ss::signal_traits<void(int)>, counting_allocator<std::function<void(int)>>>;
+      allocation_tally left_tally, right_tally;
+      {
+        queued_type left { &left_tally }, right { &right_tally };
+        std::vector<int> calls;
+        left.connect([&] (int v) { calls.push_back(v); });
+        right.connect([&] (int v) { calls.push_back(v * 10); });
+        left.emit_deferred(1);
+        left.emit_deferred(2);
+        right.emit_deferred(3);
+        std::swap(left, right);
+        AssertThat(left.queued(), Equals(1u));
+        AssertThat(right.queued(), Equals(2u));
+        left.flush();
+        right.flush();
+        AssertThat(calls, Equals(std::vector<int>({ 30, 1, 2 })));
+      }
+      AssertThat(left_tally.outstanding, Equals(0));
+      AssertThat(right_tally.outstanding, Equals(0));
+    });
+#if defined(SLIMSIG_HAS_PMR) && SLIMSIG_HAS_PMR
+    it("should work with std::pmr memory resources", [&]
+    {
+      alignas(std::max_align_t) unsigned char buffer[8192];
+      // nothing may fall back to an upstream resource
+      std::pmr::monotonic_buffer_resource arena { buffer, sizeof(buffer), std::pmr::null_memory_resource() };
+      ss::pmr::signal<void(int)> signal { &arena };
+      ss::pmr::small_signal<void(int), 2> small { &arena };
+      std::array<char, 64> padding{};
+      int total = 0;
+      for (int i = 0; i < 4; i++) {
+        signal.connect([&, padding] (int v) { total += v + padding[0]; });
+        small.connect([&] (int v) { total += v * 10; });
+      }
+      signal.emit(1);
+      small.emit(1);
+      AssertThat(total, Equals(44));
+    });
+    it("should move and swap pmr queued signals", [&]
+    {
+      std::pmr::monotonic_buffer_resource first_arena, second_arena;
+      ss::pmr::queued_signal<void(int)> first { &first_arena }, second { &second_arena }, third { &first_arena };
+      int total = 0;
+      first.connect([&] (int v) { total += v; });
+      second.connect([&] (int v) { total += v * 10; });
+      first.emit_deferred(1);
+      second.emit_deferred(2);
+      // same resource, the arenas trade chunks
+      third = std::move(first);
+      // different resources, the events are moved into the other arena
+      std::swap(third, second);
+      AssertThat(second.flush(), Equals(1u));
+      AssertThat(third.flush(), Equals(1u));
+      AssertThat(total, Equals(21));
+    });
+#endif
+  });
+  describe("keyed_signal", [] {
+    using signal_type = ss::keyed_signal<int, void(std::string&)>;
+    it("should only call the slots connected under the emitted key", [&]
+    {
+      signal_type signal;
+      std::vector<std::string> calls;
+      signal.connect(1, [&] (std::string& s) { calls.push_back("one " + s); });
+      signal.connect(2, [&] (std::string& s) { calls.push_back("two " + s); });
+      signal.connect(1, [&] (std::string& s) { calls.push_back("uno " + s); });
+      std::string message = "a";
+      signal.emit(1, message);
+      signal.emit(3, message);
+      AssertThat(calls, Equals(std::vector<std::string>({ "one a", "uno a" })));
+      AssertThat(signal.slot_count(), Equals(3u));
+      AssertThat(signal.slot_count(1), Equals(2u));
+      AssertThat(signal.key_count(), Equals(2u));
+    });
+    it("should call wildcard slots after the keyed slots", [&]
+    {
+      signal_type signal;
+      std::vector<std::string> calls;
+      signal.connect(1, [&] (std::string& s) { calls.push_back("one " + s); });
+      auto any = signal.connect_any([&] (const int& key, std::string& s) { calls.push_back(std::to_string(key) + " " + s); });
+      std::string message = "a";
+      signal.emit(1, message);
+      signal.emit(2, message);
+      any.disconnect();
+      signal.emit(2, message);
+      AssertThat(calls, Equals(std::vector<std::string>({ "one a", "1 a", "2 a" })));
+    });
+    it("should handle connects and disconnects under other keys while emitting", [&]
+    {
+      signal_type signal;
+      std::vector<std::string> calls;
+      std::vector<signal_type::connection> connections;
+      signal.connect(0, [&] (std::string& s) {
+        // enough new keys to force a rehash under the running signal
+        for (int key = 100; key < 164; key++) signal.connect(key, [&] (std::string& v) { calls.push_back(v); });
+        connections[0].disconnect();
+        calls.push_back("zero " + s);
+      });
+      connections.push_back(signal.connect(1, [&] (std::string& s) { calls.push_back("one " + s); }));
+      signal.connect(0, [&] (std::string& s) { signal.emit(1, s); });
+      std::string message = "a";
+      signal.emit(0, message);
+      AssertThat(calls, Equals(std::vector<std::string>({ "zero a" })));
+      // key 1 is dropped by the emit that finds it empty
+      AssertThat(signal.key_count(), Equals(65u));
+      calls.clear();
+      signal.emit(163, message);
+      AssertThat(calls, Equals(std::vector<std::string>({ "a" })));
+      signal.disconnect_all();
+      AssertThat(signal.key_count(), Equals(0u));
+      AssertThat(signal.empty(), Equals(true));
+    });
+    it("should combine the results of the keyed slots", [&]
+    {
+      ss::keyed_signal<std::string, int(int), max_traits> signal;
+      signal.connect("double", [] (int v) { return v * 2; });
+      signal.connect("double", [] (int v) { return v; });
+      signal.connect_any([] (const std::string&, int v) { return v * 100; });
+      AssertThat(signal.emit("double", 3), Equals(6));
+      AssertThat(signal.emit("missing", 3), Equals(0));
+    });
+  });
+  describe("static_signal", [] {
+    it("should call every slot in order", [&]
+    {
+      std::vector<int> calls;
+      auto signal = ss::make_static_signal<void(int)>(
+        [&] (int value) { calls.push_back(value); },
+        [&] (int value) { calls.push_back(value * 10); });
+      signal.emit(1);
+      signal(2);
+      AssertThat(calls, Equals(std::vector<int>({ 1, 10, 2, 20 })));
+      AssertThat(signal.slot_count(), Equals(2u));
+      AssertThat(signal.empty(), Equals(false));
+    });
+    it("should return the last slot's result", [&]
+    {
+      auto signal = ss::make_static_signal<int(int)>(
+        [] (int value) { return value + 1; },
+        [] (int value) { return value * 2; });
+      AssertThat(signal.emit(5), Equals(10));
+      AssertThat(signal.emit_with(ss::sum<int>(), 5), Equals(16));
+      AssertThat(signal.emit_with(ss::minimum<int>(), 5), Equals(6));
+      ss::static_signal<int(int)> empty;
+      AssertThat(empty.emit(5), Equals(0));
+      AssertThat(empty.empty(), Equals(true));
+    });
+    it("should pass references through to every slot", [&]
+    {
+      auto signal = ss::make_static_signal<void(int&)>(
+        [] (int& value) { value += 1; },
+        [] (int& value) { value *= 3; });
+      int value = 1;
+      signal.emit(value);
+      AssertThat(value, Equals(6));
+    });
+    it("should emit batches in either order", [&]
+    {
+      std::vector<int> calls;
+      auto signal = ss::make_static_signal<void(int)>(
+        [&] (int value) { calls.push_back(value); },
+        [&] (int value) { calls.push_back(-value); });
+      std::vector<std::tuple<int>> events { std::make_tuple(1), std::make_tuple(2) };
+      signal.emit_batch(events.begin(), events.end());
+      AssertThat(calls, Equals(std::vector<int>({ 1, -1, 2, -2 })));
+      calls.clear();
+      signal.emit_batch(events.begin(), events.end(), ss::batch_order::slot_major);
+      AssertThat(calls, Equals(std::vector<int>({ 1, 2, -1, -2 })));
+    });
+  });
+  describe("mailbox_signal", [] {
+    it("should run slots on the home thread, in order per producer", [&]
+    {
+      ss::mailbox_signal<void(int, int)> signal { 8 };
+      const int producers = 3, events = 500;
+      std::vector<std::vector<int>> seen(producers);
+      bool other_thread = false;
+      signal.connect([&] (int producer, int value) {
+        other_thread = other_thread || !signal.on_home_thread();
+        seen[producer].push_back(value);
+      });
+      std::vector<std::thread> threads;
+      for (int p = 0; p < producers; p++) {
+        threads.emplace_back([&signal, p, events] {
+          for (int i = 0; i < events; i++) signal.emit(p, i);
+        });
+      }
+      std::size_t received = 0;
+      while (received < std::size_t(producers * events)) {
+        received += signal.pump();
+        std::this_thread::yield();
+      }
+      for (auto& thread : threads) thread.join();
+      AssertThat(other_thread, Equals(false));
+      AssertThat(signal.dropped(), Equals(0u));
+      AssertThat(signal.pending(), Equals(0u));
+      for (auto& values : seen) {
+        AssertThat(values.size(), Equals(std::size_t(events)));
+        AssertThat(std::is_sorted(values.begin(), values.end()), Equals(true));
+      }
+    });
+    it("should call slots straight away when emitted on the home thread", [&]
+    {
+      ss::mailbox_signal<void(int)> signal;
+      int total = 0;
+      signal.connect([&] (int value) { total += value; });
+      AssertThat(signal.emit(2), Equals(true));
+      signal(3);
+      AssertThat(total, Equals(5));
+      AssertThat(signal.post(4), Equals(true));
+      AssertThat(total, Equals(5));
+      AssertThat(signal.pump(), Equals(1u));
+      AssertThat(total, Equals(9));
+    });
+    it("should turn down events that don't fit with the fail policy", [&]
+    {
+      ss::mailbox_signal<void(int)> signal { 4, ss::overflow_policy::fail };
+      std::vector<int> seen;
+      signal.connect([&] (int value) { seen.push_back(value); });
+      int accepted = 0;
+      std::thread([&] {
+        for (int i = 0; i < 10; i++) accepted += signal.emit(i);
+      }).join();
+      AssertThat(accepted, Equals(4));
+      AssertThat(signal.dropped(), Equals(6u));
+      AssertThat(signal.pump(), Equals(4u));
+      AssertThat(seen, Equals(std::vector<int>({ 0, 1, 2, 3 })));
+    });
+    it("should keep the newest events with the drop_oldest policy", [&]
+    {
+      ss::mailbox_signal<void(std::shared_ptr<int>)> signal { 4, ss::overflow_policy::drop_oldest };
+      std::vector<int> seen;
+      signal.connect([&] (std::shared_ptr<int> value) { seen.push_back(*value); });
+      auto first = std::make_shared<int>(0);
+      std::thread([&] {
+        signal.emit(first);
+        for (int i = 1; i < 10; i++) signal.emit(std::make_shared<int>(i));
+      }).join();
+      AssertThat(first.use_count(), Equals(1));
+      AssertThat(signal.dropped(), Equals(6u));
+      AssertThat(signal.pump(), Equals(4u));
+      AssertThat(seen, Equals(std::vector<int>({ 6, 7, 8, 9 })));
+    });
+    it("should pump events posted while pumping, but not from inside a slot", [&]
+    {
+      ss::mailbox_signal<void(int)> signal { 4 };
+      std::vector<int> seen;
+      signal.connect([&] (int value) {
+        seen.push_back(value);
+        if (value == 1) {
+          signal.post(3);
+          AssertThat(signal.pump(), Equals(0u));
+        }
+      });
+      signal.post(1);
+      signal.post(2);
+      AssertThat(signal.pump(), Equals(3u));
+      AssertThat(seen, Equals(std::vector<int>({ 1, 2, 3 })));
+      signal.post(4);
+      signal.post(5);
+      AssertThat(signal.pump(1), Equals(1u));
+      AssertThat(signal.pending(), Equals(1u));
+      AssertThat(signal.pump(), Equals(1u));
+    });
+    it("should not wait on itself when the home thread posts to a full mailbox", [&]
+    {
+      ss::mailbox_signal<void(int)> signal { 2 };
+      std::vector<int> seen;
+      bool accepted = true;
+      signal.connect([&] (int value) {
+        seen.push_back(value);
+        // every cell is claimed by this pump, nothing could ever make room
+        if (value == 3) accepted = signal.post(5);
+      });
+      signal.post(1);
+      signal.post(2);
+      // the home thread pumps what's there to make room
+      AssertThat(signal.post(3), Equals(true));
+      AssertThat(seen, Equals(std::vector<int>({ 1, 2 })));
+      AssertThat(signal.post(4), Equals(true));
+      AssertThat(signal.pump(), Equals(2u));
+      AssertThat(accepted, Equals(false));
+      AssertThat(signal.dropped(), Equals(1u));
+      AssertThat(seen, Equals(std::vector<int>({ 1, 2, 3, 4 })));
+
+      ss::mailbox_signal<void(int)> dropping { 2, ss::overflow_policy::drop_oldest };
+      dropping.connect([&] (int value) {
+        if (value == 1) accepted = dropping.post(3);
+      });
+      dropping.post(1);
+      dropping.post(2);
+      AssertThat(dropping.pump(), Equals(2u));
+      AssertThat(accepted, Equals(false));
+      AssertThat(dropping.dropped(), Equals(1u));
+    });
+    it("should destroy events nobody pumped", [&]
+    {
+      auto value = std::make_shared<int>(1);
+      {
+        ss::mailbox_signal<void(std::shared_ptr<int>)> signal;
+        signal.post(value);
+        signal.post(value);
+        AssertThat(value.use_count(), Equals(3));
+      }
+      AssertThat(value.use_count(), Equals(1));
+    });
+  });
+  describe("compact_signal", [] {
+    it("should be the size of a pointer and only allocate once connected", [&]
+    {
+      AssertThat(sizeof(ss::compact_signal<void(int)>), Equals(sizeof(void*)));
+      allocation_tally tally;
+      {
+        ss::compact_signal<int(int), ss::signal_traits<int(int)>, counting_allocator<std::function<int(int)>>> signal { &tally };
+        AssertThat(signal.emit(1), Equals(0));
+        AssertThat(signal.emit_with(ss::sum<int>(), 1), Equals(0));
+        AssertThat(signal.empty(), Equals(true));
+        AssertThat(tally.allocations, Equals(0u));
+        signal.connect([] (int value) { return value + 1; });
+        signal.connect([] (int value) { return value * 10; });
+        AssertThat(signal.allocated(), Equals(true));
+        AssertThat(tally.outstanding > 0, Equals(true));
+        AssertThat(signal.emit(2), Equals(20));
+        AssertThat(signal.emit_with(ss::sum<int>(), 2), Equals(23));
+        signal.disconnect_all();
+        AssertThat(signal.allocated(), Equals(false));
+        AssertThat(tally.outstanding, Equals(0));
+        signal.connect([] (int value) { return value; });
+        AssertThat(signal.slot_count(), Equals(1u));
+      }
+      AssertThat(tally.outstanding, Equals(0));
+    });
+    it("should connect, disconnect and relay from inside slots like signal", [&]
+    {
+      ss::compact_signal<void(int)> signal;
+      auto relayed = std::make_shared<ss::signal<void(int)>>();
+      std::vector<int> calls;
+      accumulator target;
+      relayed->connect([&] (int value) { calls.push_back(value * 100); });
+      signal.connect_extended([&] (connection_t<void(int)>& self, int value) {
+        calls.push_back(value);
+        self.disconnect();
+        signal.connect([&] (int value) { calls.push_back(-value); });
+      });
+      signal.connect(relayed);
+      signal.connect(&target, &accumulator::add);
+      signal.emit(1);
+      signal.emit(2);
+      AssertThat(calls, Equals(std::vector<int>({ 1, 100, 200, -2 })));
+      AssertThat(target.total, Equals(3));
+      AssertThat(signal.slot_count(), Equals(3u));
+      signal.connect([&] (int) { signal.disconnect_all(); });
+      signal.emit(3);
+      AssertThat(signal.empty(), Equals(true));
+      // still emitting, so the signal stays until the next disconnect_all
+      AssertThat(signal.allocated(), Equals(true));
+      signal.disconnect_all();
+      AssertThat(signal.allocated(), Equals(false));
+    });
+    it("should keep connections working through moves and swaps", [&]
+    {
+      int total = 0;
+      ss::compact_signal<void(int)> first;
+      auto conn = first.connect([&] (int value) { total += value; });
+      ss::compact_signal<void(int)> second { std::move(first) };
+      first.emit(1);
+      second.emit(2);
+      AssertThat(total, Equals(2));
+      swap(first, second);
+      first.emit(3);
+      AssertThat(total, Equals(5));
+      AssertThat(conn.connected(), Equals(true));
+      conn.disconnect();
+      AssertThat(first.empty(), Equals(true));
+      allocation_tally left_tally, right_tally;
+      using counted = ss::compact_signal<void(int), ss::signal_traits<void(int)>, counting_allocator<std::function<void(int)>>>;
+      counted left { &left_tally }, right { &right_tally };
+      left.connect([&] (int value) { total += value * 10; });
+      left.swap(right);
+      right.emit(1);
+      AssertThat(total, Equals(15));
+      AssertThat(left.empty(), Equals(true));
+    });
+  });
+  describe("slab_allocator", [] {
+    it("should pack many small signals into shared pages", [&]
+    {
+      ss::slab_pool pool;
+      int total = 0;
+      {
+        std::vector<ss::slab_signal<void(int)>> signals;
+        for (int i = 0; i < 200; i++) {
+          signals.emplace_back(&pool);
+          signals.back().connect([&] (int value) { total += value; });
+          signals.back().connect([&] (int value) { total -= value * 2; });
+        }
+        for (auto& signal : signals) signal.emit(1);
+        AssertThat(total, Equals(-200));
+        AssertThat(pool.blocks_in_use() >= 400u, Equals(true));
+        AssertThat(pool.pages() < 10u, Equals(true));
+      }
+      AssertThat(pool.blocks_in_use(), Equals(0u));
+    });
+    it("should reuse freed blocks instead of growing", [&]
+    {
+      ss::slab_pool pool;
+      int calls = 0;
+      auto churn = [&] {
+        for (int i = 0; i < 100; i++) {
+          ss::slab_signal<void()> signal { &pool };
+          for (int n = 0; n < 5; n++) signal.connect([&] { calls++; });
+          signal.emit();
+        }
+      };
+      churn();
+      auto pages = pool.pages();
+      churn();
+      AssertThat(calls, Equals(1000));
+      AssertThat(pool.pages(), Equals(pages));
+      AssertThat(pool.blocks_in_use(), Equals(0u));
+    });
+    it("should give blocks back to the pool on disconnect_all", [&]
+    {
+      ss::slab_pool pool;
+      ss::slab_signal<void(int)> signal { &pool };
+      int total = 0;
+      for (int i = 0; i < 20; i++) signal.connect([&] (int value) { total += value; });
+      signal.emit(1);
+      AssertThat(pool.blocks_in_use() > 0u, Equals(true));
+      signal.disconnect_all();
+      AssertThat(pool.blocks_in_use(), Equals(0u));
+      // from inside an emit, once it finishes
+      for (int i = 0; i < 20; i++) signal.connect([&] (int) { signal.disconnect_all(); });
+      signal.emit(1);
+      AssertThat(pool.blocks_in_use(), Equals(0u));
+      AssertThat(total, Equals(20));
+    });
+    it("should align over-aligned requests it doesn't pool", [&]
+    {
+      struct alignas(64) line { char bytes[64]; };
+      ss::slab_pool pool;
+      ss::slab_allocator<line> alloc { &pool };
+      auto small = alloc.allocate(1);
+      auto big = alloc.allocate(40);
+      AssertThat(reinterpret_cast<std::uintptr_t>(small) % 64, Equals(0u));
+      AssertThat(reinterpret_cast<std::uintptr_t>(big) % 64, Equals(0u));
+      alloc.deallocate(small, 1);
+      alloc.deallocate(big, 40);
+      AssertThat(pool.blocks_in_use(), Equals(0u));
+    });
+    it("should hold compact signals and oversized callables", [&]
+    {
+      ss::slab_pool pool;
+      {
+        ss::compact_signal<void(), ss::signal_traits<void()>, ss::slab_allocator<std::function<void()>>> signal { &pool };
+        AssertThat(pool.blocks_in_use(), Equals(0u));
+        std::array<char, 2048> huge{};
+        int calls = 0;
+        signal.connect([huge, &calls] { calls += 1 + huge[0]; });
+        signal.emit();
+        AssertThat(calls, Equals(1));
+        AssertThat(pool.blocks_in_use() > 0u, Equals(true));
+        signal.disconnect_all();
+        AssertThat(pool.blocks_in_use(), Equals(0u));
+      }
+    });
   });
   /*
   describe("tracking", [] {
@@ -286,7 +1932,70 @@ go_bandit([]
       }
       AssertThat(connection.connected(), Equals(false));
     });
-    
+    it("should disconnect the right slot after the signal compacts", [&]
+    {
+      unsigned first = 0, second = 0;
+      auto removed = signal.connect([]{});
+      auto conn1 = signal.connect([&] { first++; });
+      auto conn2 = signal.connect([&] { second++; });
+      removed.disconnect();
+      // the first emit compacts, moving the remaining slots down
+      signal.emit();
+      conn2.disconnect();
+      signal.emit();
+      AssertThat(first, Equals(2u));
+      AssertThat(second, Equals(1u));
+      AssertThat(conn1.connected(), Equals(true));
+    });
+    it("should not be revived when its handle is reused", [&]
+    {
+      auto old_connection = signal.connect([]{});
+      old_connection.disconnect();
+      for (int i = 0; i < 256; i++) signal.connect([]{});
+      AssertThat(old_connection.connected(), Equals(false));
+      old_connection.disconnect();
+      AssertThat(signal.slot_count(), Equals(256u));
+    });
+    it("should retire a handle instead of letting its generation wrap", [&]
+    {
+      auto& table = ss::detail::handle_table::instance();
+      int owner = 0;
+      auto first = table.acquire(&owner, 0);
+      table.release(first.index);
+      // as if the entry had been connected and disconnected 2^31 times, the next acquire reuses it
+      table.at(first.index).generation.store(~std::uint32_t(0) - 1);
+      auto last = table.acquire(&owner, 0);
+      AssertThat(last.index, Equals(first.index));
+      table.release(last.index);
+      auto next = table.acquire(&owner, 0);
+      AssertThat(next.index == first.index, Equals(false));
+      AssertThat(table.alive(first), Equals(false));
+      AssertThat(table.alive(last), Equals(false));
+      table.release(next.index);
+    });
+    it("should disconnect thread_local signals destroyed after the thread's handle cache", [&]
+    {
+      using connection_type = ss::signal<void()>::connection;
+      connection_type connection;
+      std::thread([&] {
+        // constructed before the thread's first connect, so destroyed after the handle cache it creates
+        static thread_local ss::signal<void()> late;
+        connection = late.connect([]{});
+      }).join();
+      AssertThat(connection.connected(), Equals(false));
+      auto fresh = signal.connect([]{});
+      fresh.disconnect();
+      AssertThat(fresh.connected(), Equals(false));
+    });
+    it("should follow the slot when signals are moved", [&]
+    {
+      ss::signal<void()> other;
+      auto connection = signal.connect([]{});
+      other = std::move(signal);
+      AssertThat(connection.connected(), Equals(true));
+      connection.disconnect();
+      AssertThat(other.empty(), Equals(true));
+    });
   });
   describe("scoped_connection", []{
     ss::signal<void()> signal;
@@ -311,6 +2020,112 @@ go_bandit([]
       AssertThat(connection.connected(), Equals(false));
     });
   });
+  describe("connection_set", []{
+    it("should skip signals destroyed by disconnecting an earlier one", [&]
+    {
+      using signal_type = ss::signal<void(int), concurrent_traits>;
+      auto first = std::make_shared<signal_type>();
+      auto second = std::make_shared<signal_type>();
+      // groups go in address order, the signal disconnected first owns the other one
+      auto holder = std::less<signal_type*>()(first.get(), second.get()) ? first : second;
+      auto owner = holder == first ? second : first;
+      std::weak_ptr<signal_type> held = owner;
+      first.reset();
+      second.reset();
+      ss::connection_set set;
+      for (int i = 0; i < 3; i++) set += owner->connect([] (int) {});
+      set += holder->connect([owner] (int) {});
+      owner.reset();
+      set.disconnect_all();
+      AssertThat(held.expired(), Equals(true));
+      AssertThat(holder->slot_count(), Equals(0u));
+    });
+    it("should disconnect connections to every signal when it goes out of scope", [&]
+    {
+      ss::signal<void()> plain;
+      ss::signal<void(int), split_traits> split;
+      ss::signal<void(int), concurrent_traits> concurrent;
+      int calls = 0;
+      auto kept = plain.connect([&] { calls += 100; });
+      {
+        ss::connection_set set;
+        set.reserve(64);
+        for (int i = 0; i < 10; i++) {
+          set += plain.connect([&] { calls++; });
+          set += split.connect([&] (int) { calls++; });
+          set.add(concurrent.connect([&] (int) { calls++; }));
+        }
+        auto gone = plain.connect([] {});
+        gone.disconnect();
+        set += gone;
+        set += connection();
+        {
+          ss::signal<void()> temporary;
+          set += temporary.connect([] {});
+        }
+        AssertThat(set.size(), Equals(32u));
+        plain.emit();
+        AssertThat(calls, Equals(110));
+      }
+      plain.emit();
+      split.emit(0);
+      concurrent.emit(0);
+      AssertThat(calls, Equals(210));
+      AssertThat(plain.slot_count(), Equals(1u));
+      AssertThat(split.empty(), Equals(true));
+      AssertThat(concurrent.empty(), Equals(true));
+      AssertThat(kept.connected(), Equals(true));
+    });
+    it("should disconnect from inside a running emit", [&]
+    {
+      ss::signal<void()> signal;
+      ss::connection_set set;
+      std::vector<int> calls;
+      set += signal.connect([&] { calls.push_back(1); set.disconnect_all(); });
+      set += signal.connect([&] { calls.push_back(2); });
+      signal.connect([&] { calls.push_back(3); });
+      signal.emit();
+      signal.emit();
+      AssertThat(calls, Equals(std::vector<int>({ 1, 3, 3 })));
+      AssertThat(set.empty(), Equals(true));
+    });
+    it("should hand its connections over when moved and forget them on release", [&]
+    {
+      ss::signal<void(int), concurrent_traits> signal;
+      ss::connection_set outer;
+      {
+        ss::connection_set inner;
+        for (int i = 0; i < 5; i++) inner += signal.connect([] (int) {});
+        outer = std::move(inner);
+      }
+      AssertThat(signal.slot_count(), Equals(5u));
+      ss::connection_set other { std::move(outer) };
+      other.release();
+      AssertThat(signal.slot_count(), Equals(5u));
+      for (int i = 0; i < 5; i++) outer += signal.connect([] (int) {});
+      outer.disconnect_all();
+      AssertThat(signal.slot_count(), Equals(5u));
+    });
+    it("should disconnect from a concurrent signal while another thread emits", [&]
+    {
+      ss::signal<void(int), concurrent_traits> signal;
+      std::atomic<int> calls { 0 };
+      ss::connection_set set;
+      for (int i = 0; i < 100; i++) set += signal.connect([&] (int) { calls++; });
+      std::atomic<bool> done { false };
+      std::thread emitter([&] {
+        while (!done) signal.emit(0);
+      });
+      while (calls.load() < 100) std::this_thread::yield();
+      set.disconnect_all();
+      done = true;
+      emitter.join();
+      auto after = calls.load();
+      signal.emit(0);
+      AssertThat(calls.load(), Equals(after));
+      AssertThat(signal.empty(), Equals(true));
+    });
+  });
 });
 int main(int argc, char* argv[]) {
   bandit::run(argc, argv);